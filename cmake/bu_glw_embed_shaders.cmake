@@ -0,0 +1,41 @@
+# Run by bu_glw_embed_shaders() at build time, in script mode:
+#   cmake -DNAME=<name> -DOUTPUT=<header> -DSOURCES=<file|file|...> -P bu_glw_embed_shaders.cmake
+# Writes a header with one constexpr byte array and one EmbeddedShader per file.
+
+string(REPLACE "|" ";" SOURCES "${SOURCES}")
+string(MAKE_C_IDENTIFIER "${NAME}" prefix)
+string(TOUPPER "${prefix}" guard)
+string(REPEAT "[0-9a-f]" 32 line_pattern)
+
+set(content "/* Generated by bu_glw_embed_shaders() from CMake at build time. Do not edit, edit the shaders instead. */\n")
+string(APPEND content "#ifndef BU_GLW_EMBEDDED_${guard}_HEADER\n#define BU_GLW_EMBEDDED_${guard}_HEADER\n\n#include \"bu_glw.hpp\"\n")
+
+foreach(path IN LISTS SOURCES)
+	get_filename_component(file_name "${path}" NAME)
+	string(MAKE_C_IDENTIFIER "${prefix}_${file_name}" identifier)
+
+	file(READ "${path}" hex HEX)
+	string(LENGTH "${hex}" hex_length)
+	math(EXPR length "${hex_length} / 2")
+	file(SHA256 "${path}" sha256)
+	string(SUBSTRING "${sha256}" 0 16 hash)
+
+	# 16 bytes per line.
+	string(REGEX REPLACE "(${line_pattern})" "\\1\n\t" bytes "${hex}")
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${bytes}")
+
+	# The path goes into a string literal, which it must neither end early nor form trigraphs or escapes in.
+	string(REPLACE "\\" "\\\\" path_literal "${path}")
+	string(REPLACE "\"" "\\\"" path_literal "${path_literal}")
+	string(REPLACE "?" "\\?" path_literal "${path_literal}")
+	string(REPLACE "\n" "\\n" path_literal "${path_literal}")
+	string(REPLACE "\r" "\\r" path_literal "${path_literal}")
+
+	string(APPEND content "\n/* ${file_name} */\n")
+	string(APPEND content "static constexpr unsigned char ${identifier}_data[${length} + 1] = {\n\t${bytes}0x00\n};\n")
+	string(APPEND content "static constexpr EmbeddedShader ${identifier} = {${identifier}_data, ${length}, 0x${hash}ull, \"${path_literal}\"};\n")
+endforeach()
+
+string(APPEND content "\n#endif\n")
+
+file(WRITE "${OUTPUT}" "${content}")
@@ -12,6 +12,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include "GL/gl3w.h"
 #include "GL/gl.h"
 #include "bu_glw_except.hpp"
@@ -32,6 +33,23 @@
 #define BU_GLW_NO_BOUNDS_CHECKING 0
 #endif
 
+/* Should shaders embedded with bu_glw_embed_shaders() be read from their original files instead, so edits show up without a rebuild?
+ * Set through the BU_GLW_SHADERS_FROM_DISK CMake option. Falls back to the embedded copy if the file can not be read. */
+#ifndef BU_GLW_SHADERS_FROM_DISK
+#define BU_GLW_SHADERS_FROM_DISK 0
+#endif
+
+/* Should bu_glw_trace_begin() be able to capture a trace of the wrapper operations? Set through the BU_GLW_TRACE CMake option.
+ * When built in but not capturing, every operation pays for one relaxed atomic load. */
+#ifndef BU_GLW_TRACE
+#define BU_GLW_TRACE 0
+#endif
+
+/* Should the wrappers keep count of the GPU memory their allocations take? Costs an atomic addition per allocation. */
+#ifndef BU_GLW_TRACK_MEMORY
+#define BU_GLW_TRACK_MEMORY 1
+#endif
+
 #ifndef BU_GLW_MAX_UNIFORM_NAME_LENGTH
 #define BU_GLW_MAX_UNIFORM_NAME_LENGTH 32
 #endif
@@ -46,6 +64,58 @@
 #define OPENGL_VERSION_MINOR 2
 #endif
 
+/* Evaluates to 1 if the targeted OpenGL version is at least major.minor. */
+#define BU_GLW_GL_VERSION_AT_LEAST(major, minor) \
+	(OPENGL_VERSION_MAJOR > (major) || (OPENGL_VERSION_MAJOR == (major) && OPENGL_VERSION_MINOR >= (minor)))
+
+
+/********************** Memory accounting *******************/
+
+enum GpuMemoryCategory{
+	BU_GLW_MEMORY_VERTEX_BUFFERS,
+	BU_GLW_MEMORY_INDEX_BUFFERS,
+	BU_GLW_MEMORY_STORAGE_BUFFERS,
+	BU_GLW_MEMORY_READBACK_BUFFERS,
+	BU_GLW_MEMORY_RENDER_TARGETS,
+	BU_GLW_MEMORY_CATEGORY_COUNT
+};
+
+/* Sizes are what the wrappers requested, drivers may round them up. Everything is zero if BU_GLW_TRACK_MEMORY is 0. */
+struct GpuMemoryStats{
+	int64_t bytes[BU_GLW_MEMORY_CATEGORY_COUNT];
+	int64_t peak_bytes[BU_GLW_MEMORY_CATEGORY_COUNT];
+	uint64_t allocations[BU_GLW_MEMORY_CATEGORY_COUNT]; /* Every (re)specification of storage counts. */
+	int64_t total_bytes;
+	int64_t peak_total_bytes;
+};
+
+/* Record that an allocation of the category changed from old_size to new_size bytes. Thread safe. */
+void bu_glw_memory_track(GpuMemoryCategory category, int64_t old_size, int64_t new_size);
+GpuMemoryStats bu_glw_memory_stats();
+const char* bu_glw_memory_category_name(GpuMemoryCategory category);
+
+/************************** Tracing *************************/
+/* With BU_GLW_TRACE, the wrapper operations (buffer uploads, VAO setup, shader sources, uniforms, binds, draws and dispatches)
+ * can be written to a binary trace, see bu_glw_trace_format.hpp, and replayed with the bu_glw_replay tool.
+ * Only what goes through the wrappers is captured, so begin before creating the objects of interest.
+ * The trace is written by a background thread; the calling thread only hashes and copies. Payloads are kept in memory to
+ * recognize repeats, up to BU_GLW_TRACE_PAYLOAD_MEMORY bytes; older ones are written again when they come back. Capturing
+ * may be started and stopped from another thread than the one making the calls. */
+
+/* Start capturing into the file. Throws BuGlwIOError if it can not be opened. Does nothing without BU_GLW_TRACE. */
+void bu_glw_trace_begin(const char* path);
+/* Mark the end of a frame. */
+void bu_glw_trace_frame();
+/* Stop capturing and wait for everything to be written. Throws BuGlwIOError if writing failed. */
+void bu_glw_trace_end();
+bool bu_glw_tracing();
+
+/************************** Drawing *************************/
+/* Plain glDraw* calls, which also go into traces. */
+
+void bu_glw_draw_arrays(GLenum mode, GLint first, GLsizei count);
+/* offset is in bytes into the bound EBO. */
+void bu_glw_draw_elements(GLenum mode, GLsizei count, GLenum type, GLintptr offset = 0);
 
 /************************** Shaders *************************/
 
@@ -53,11 +123,42 @@
 class Shader;
 class VertexShader;
 class FragmentShader;
+class ComputeShader;
 class ShaderProgram;
+class ComputeProgram;
+class StageProgram;
+class ProgramPipeline;
+class SSBO;
 struct Uniform;
 
 char* bu_glw_read_file_into_string(const char* path);
 
+/* A read-only view of a whole file. On Linux the file is memory mapped, elsewhere it is read into memory. */
+class MappedFile{
+	const unsigned char* m_data;
+	size_t m_size;
+public:
+	MappedFile(const char* path); /* May throw BuGlwBadFilePath or BuGlwIOError. */
+	~MappedFile();
+	MappedFile(MappedFile&& other) noexcept;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const unsigned char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+};
+
+/* A shader source embedded into the binary at build time by the bu_glw_embed_shaders() CMake function. */
+struct EmbeddedShader{
+	const unsigned char* data; /* Null terminated, though length does not count the terminator. */
+	GLint length;
+	uint64_t hash; /* The first 64 bits of the SHA-256 of the file. */
+	const char* path; /* Absolute path of the file it was embedded from. */
+
+	const GLchar* source() const { return (const GLchar*)data; }
+};
+
 struct Uniform{
 	char name[BU_GLW_MAX_UNIFORM_NAME_LENGTH + 1];
 	GLint ID;
@@ -73,8 +174,8 @@ public:
 protected:
 public:
 	Shader(const char* path, GLenum type);
-	/* Move constructor. */
-	Shader(Shader&&) = default;
+	/* Move constructor. The moved-from shader is left without a GPU object, so it is deleted only once. */
+	Shader(Shader&& other) noexcept;
 	~Shader();
 
 	/* No copy constructor. */
@@ -84,6 +185,11 @@ public:
 
 public:
 	void compile(); /* May throw exceptions if any errors occur. */
+	/* Compile from several strings handed directly to glShaderSource, without joining them. lengths may be NULL if every string is null terminated.
+	 * The shader should have been constructed with a nullptr path. May throw exceptions if any errors occur. */
+	void compile(GLsizei count, const GLchar* const* strings, const GLint* lengths);
+	/* Compile an embedded source, or its original file with BU_GLW_SHADERS_FROM_DISK. The shader should have been constructed with a nullptr path. */
+	void compile(const EmbeddedShader& source);
 	void attachTo(const GLuint program_id);
 	
 
@@ -121,15 +227,25 @@ public:
 	FragmentShader m_fs;
 	VertexShader m_vs;
 	GeomteryShader m_gs;
-	const GLuint m_ID;
+	GLuint m_ID;
 
 	Uniform* m_uniforms;
 	unsigned int m_uniform_list_size;
 	unsigned int m_uniform_list_length;
 public:
-	ShaderProgram(VertexShader& vertex_shader, FragmentShader& fragment_shader);
-	ShaderProgram(const char* vertex_shader_path, const char* fragment_shader_path);
-	ShaderProgram(const char* geometry_shader_path, const char* vertex_shader_path, const char* fragment_shader_path);
+	/* With separable set, the program is linked with GL_PROGRAM_SEPARABLE so its stages can be used in a ProgramPipeline (see ProgramPipeline::useStages). */
+	ShaderProgram(VertexShader& vertex_shader, FragmentShader& fragment_shader, bool separable = false);
+	ShaderProgram(const char* vertex_shader_path, const char* fragment_shader_path, bool separable = false);
+	ShaderProgram(const char* geometry_shader_path, const char* vertex_shader_path, const char* fragment_shader_path, bool separable = false);
+	/* From sources embedded with bu_glw_embed_shaders(), without touching the filesystem. May throw. */
+	ShaderProgram(const EmbeddedShader& vertex_shader, const EmbeddedShader& fragment_shader, bool separable = false);
+	ShaderProgram(const EmbeddedShader& vertex_shader, const EmbeddedShader& geometry_shader, const EmbeddedShader& fragment_shader, bool separable = false);
+	/* Move constructor. The moved-from program no longer owns the GPU program nor the uniform list. */
+	ShaderProgram(ShaderProgram&& other) noexcept;
+	~ShaderProgram();
+
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
 	
 	void use();
 
@@ -154,12 +270,172 @@ public:
 	void setUniform(unsigned int ID, GLuint v0, GLuint v1, GLuint v2, GLuint v3);
 };
 
+/********************** Separable programs ******************/
+/* Separable programs and program pipelines need an OpenGL 4.1 context, regardless of OPENGL_VERSION_MAJOR/MINOR.
+ * Every stage is compiled once into its own program and pipelines combine them at bind time, without linking. */
+
+class StageProgram{
+public:
+	GLuint m_ID;
+	GLenum m_shader_type;
+public:
+	/* Read the source from a file and compile it into a separable program with glCreateShaderProgramv. May throw. */
+	StageProgram(const char* path, GLenum type);
+	/* Compile from several strings at once, e.g. a #version line, some #defines and the rest of a source. May throw. */
+	StageProgram(GLenum type, GLsizei count, const GLchar* const* strings);
+	/* Move constructor. The moved-from program no longer owns the GPU program. */
+	StageProgram(StageProgram&& other) noexcept;
+	~StageProgram();
+
+	StageProgram(const StageProgram&) = delete;
+	StageProgram& operator=(const StageProgram&) = delete;
+
+	GLbitfield stageBit() const; /* The GL_*_SHADER_BIT matching the stage, as used by glUseProgramStages. */
+	GLint getUniformLocation(const char* name); /* May throw if the uniform does not exist on the GPU. */
+
+	/* These use glProgramUniform*, so they always target this stage and nothing has to be bound. */
+	void setUniform(GLint location, GLfloat v0);
+	void setUniform(GLint location, GLfloat v0, GLfloat v1);
+	void setUniform(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+	void setUniform(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+
+	void setUniform(GLint location, GLint v0);
+	void setUniform(GLint location, GLint v0, GLint v1);
+	void setUniform(GLint location, GLint v0, GLint v1, GLint v2);
+	void setUniform(GLint location, GLint v0, GLint v1, GLint v2, GLint v3);
+
+	void setUniform(GLint location, GLuint v0);
+	void setUniform(GLint location, GLuint v0, GLuint v1);
+	void setUniform(GLint location, GLuint v0, GLuint v1, GLuint v2);
+	void setUniform(GLint location, GLuint v0, GLuint v1, GLuint v2, GLuint v3);
+};
+
+class ProgramPipeline{
+public:
+	GLuint m_ID;
+public:
+	ProgramPipeline();
+	ProgramPipeline(const StageProgram& vertex_stage, const StageProgram& fragment_stage);
+	ProgramPipeline(const StageProgram& vertex_stage, const StageProgram& geometry_stage, const StageProgram& fragment_stage);
+	ProgramPipeline(ProgramPipeline&& other) noexcept;
+	~ProgramPipeline();
+
+	ProgramPipeline(const ProgramPipeline&) = delete;
+	ProgramPipeline& operator=(const ProgramPipeline&) = delete;
+
+	/* Use the given program for its stage. The pipeline does not own it, it has to outlive its use in the pipeline. */
+	void useStage(const StageProgram& stage);
+	/* Use the given stages (GL_*_SHADER_BIT) of a ShaderProgram constructed as separable. It is not owned either.
+	 * The pipeline only validates while the program is used for all the stages it was linked with. */
+	void useStages(const ShaderProgram& program, GLbitfield stages);
+	void clearStage(GLenum shader_type);
+	/* The program currently used for the given stage, 0 if none. */
+	GLuint stageProgram(GLenum shader_type) const;
+	/* Make plain glUniform* calls go to the program of the given stage. */
+	void activateStage(GLenum shader_type);
+
+	/* Unbinds any program set with glUseProgram, as that would take precedence over the pipeline. */
+	void bind();
+	void unbind();
+	bool validate(); /* Prints the info log and returns false if the stages do not fit together. */
+};
+
+/*********************** Compute shaders ********************/
+/* Compute shaders need an OpenGL 4.3 context, regardless of OPENGL_VERSION_MAJOR/MINOR. */
+
+class ComputeShader : public Shader{
+	public:
+	ComputeShader(const char* path) : Shader(path, GL_COMPUTE_SHADER){};
+	friend ComputeProgram;
+};
+
+class ComputeProgram{
+public:
+	ComputeShader m_cs;
+	GLuint m_ID;
+	GLint m_local_size[3]; /* The local_size_x/y/z declared in the shader, queried after linking. */
+public:
+	ComputeProgram(ComputeShader& compute_shader);
+	ComputeProgram(const char* compute_shader_path);
+	ComputeProgram(const EmbeddedShader& compute_shader);
+	/* Move constructor. The moved-from program no longer owns the GPU program. */
+	ComputeProgram(ComputeProgram&& other) noexcept;
+	~ComputeProgram();
+
+	ComputeProgram(const ComputeProgram&) = delete;
+	ComputeProgram& operator=(const ComputeProgram&) = delete;
+
+	void use();
+	GLint getUniformLocation(const char* name); /* May throw if the uniform does not exist on the GPU. */
+
+	/* These bind the program and then dispatch. */
+	void dispatch(GLuint groups_x, GLuint groups_y = 1, GLuint groups_z = 1);
+	/* Dispatch enough work groups to cover (at least) the given number of invocations in each dimension. */
+	void dispatchInvocations(GLuint count_x, GLuint count_y = 1, GLuint count_z = 1);
+	/* The group counts are read from the buffer bound to GL_DISPATCH_INDIRECT_BUFFER, at the given byte offset. */
+	void dispatchIndirect(GLintptr offset = 0);
+	/* Bind the buffer as GL_DISPATCH_INDIRECT_BUFFER first. It must hold three GLuints at the given byte offset. */
+	void dispatchIndirect(const SSBO& buffer, GLintptr offset = 0);
+};
+
+/* Memory barriers to be issued between a dispatch and whatever consumes its results. */
+void bu_glw_memory_barrier(GLbitfield barriers = GL_ALL_BARRIER_BITS);
+void bu_glw_storage_barrier(); /* Shader storage writes become visible to later shader reads and writes. */
+void bu_glw_image_barrier(); /* Image stores become visible to later image loads. */
+void bu_glw_vertex_barrier(); /* Buffers written by a shader may then be used as vertex or index data. */
+void bu_glw_command_barrier(); /* Buffers written by a shader may then be used as indirect dispatch/draw commands. */
+
+/* Bind a level of a texture to an image unit, so compute shaders may load from and store to it.
+ * Unlike the other binds these do not go into traces: textures are not created through the wrappers, so a replay would
+ * have no texture to bind. */
+void bu_glw_bind_image(GLuint unit, GLuint texture, GLenum access, GLenum format, GLint level = 0);
+/* Bind a whole level of a layered texture (array, cube map, 3D) instead of a single layer. */
+void bu_glw_bind_image_layered(GLuint unit, GLuint texture, GLenum access, GLenum format, GLint level = 0);
+
+/*************************** SSBO ***************************/
+
+class SSBO{
+	GLuint m_ID;
+	GLenum m_draw_mode;
+	GLsizeiptr m_size; /* In bytes. */
+public:
+	SSBO();
+	SSBO(const void* data, GLsizeiptr size, GLenum draw_mode = GL_DYNAMIC_DRAW);
+
+	~SSBO();
+	/* No copy constructor and assignment operator - same as for VBOs. */
+	SSBO(const SSBO&) = delete;
+	SSBO& operator=(const SSBO&) = delete;
+	SSBO(SSBO&& other) noexcept;
+	SSBO& operator=(SSBO&& other) noexcept;
+
+	GLuint id() const { return m_ID; }
+	GLsizeiptr size() const { return m_size; }
+
+	void bind() const;
+	void unbind() const;
+	void data(const void* data, GLsizeiptr size); /* data may be nullptr to only allocate. */
+	void partial_data(GLintptr offset, const void* data, GLsizeiptr size);
+
+	/* Bind the whole buffer to the indexed binding point (layout(binding = index) in the shader). */
+	void bind_base(GLuint index) const;
+	/* Bind only [offset, offset + size) to the indexed binding point. The offset must be a multiple of GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT. */
+	void bind_range(GLuint index, GLintptr offset, GLsizeiptr size) const;
+
+	/* Map the buffer and run the function f on the resulting array. */
+	void map(void (*f)(void* buffer), GLenum mode = GL_READ_WRITE) const;
+};
+
 /*************************** VBO ****************************/
 
 class VBO{
 	GLuint m_ID;
 	GLuint m_draw_mode;
 	unsigned int m_length;
+	GLsizeiptr m_size; /* In bytes, for the memory accounting. */
+
+	/* Used by adopt(). */
+	VBO(GLuint id, GLenum draw_mode, unsigned int length) noexcept : m_ID{id}, m_draw_mode{draw_mode}, m_length{length}, m_size{0}{};
 public:
 	VBO();
 	VBO(const float* array, GLuint length, GLenum draw_mode = GL_STATIC_DRAW);
@@ -172,11 +448,21 @@ public:
 	/* No copy constructor and assignment operator - We don't want multiple instances corresponding to one buffer on the GPU, because that could lead to some spaghetti code.*/
 	VBO(VBO&) = delete;
 	VBO operator=(const VBO&) = delete;
+	/* Moving transfers the ownership of the buffer. The moved-from object holds 0, which glDeleteBuffers ignores. */
+	VBO(VBO&& other) noexcept;
+	VBO& operator=(VBO&& other) noexcept;
+
+	/* Take ownership of an already generated buffer name (e.g. one generated in bulk by a pool). Nothing is bound or allocated. */
+	static VBO adopt(GLuint id, GLenum draw_mode = GL_STATIC_DRAW);
+	GLuint id() const { return m_ID; }
+	GLsizeiptr size() const { return m_size; } /* Of the current storage in bytes. */
 
 	void bind() const;
 	void unbind() const;
-	void data(float* data, GLuint length);
-	void partial_data(GLintptr index, float* data, GLuint length);
+	void data(const float* data, GLuint length);
+	void partial_data(GLintptr index, const float* data, GLuint length);
+	/* Specify the storage from untyped memory, e.g. a memory mapped file. size is in bytes. */
+	void raw_data(const void* data, GLsizeiptr size);
 	
 	/* Map the buffer and run the function f on the resulting array. */
 	void map(void (*f)(void* buffer), GLenum mode) const;
@@ -197,10 +483,22 @@ class VAO{
 	unsigned int m_num_attributes;
 	unsigned int m_num_allocated_attributes;
 	GLsizei m_stride;
+
+	/* Used by adopt(). */
+	explicit VAO(GLuint id) noexcept : m_ID{id}, m_attributes{nullptr}, m_num_attributes{0}, m_num_allocated_attributes{0}, m_stride{0}{};
 public:
 
 	VAO();
 	~VAO();
+	/* No copies, a VAO owns both the GPU object and the cpu-side attribute list. */
+	VAO(const VAO&) = delete;
+	VAO& operator=(const VAO&) = delete;
+	VAO(VAO&& other) noexcept;
+	VAO& operator=(VAO&& other) noexcept;
+
+	/* Take ownership of an already generated vertex array name. Nothing is bound. */
+	static VAO adopt(GLuint id);
+	GLuint id() const { return m_ID; }
 	
 	void bind();
 	void unbind();
@@ -211,12 +509,29 @@ public:
 	void bind_attributes_no_discard();	/*Push the attributes to the gpu but also keep them around cpu-side. */
 };
 
+/* Bind a vertex array by name, e.g. to restore one queried with glGetIntegerv. Goes into traces like VAO::bind(). */
+void bu_glw_bind_vertex_array(GLuint id);
+/* Bind a buffer by name to the target, the same way for restoring a queried binding. Goes into traces like VBO::bind(). */
+void bu_glw_bind_buffer(GLenum target, GLuint id);
+/* glGenBuffers and friends for names made outside the wrapper classes, e.g. by the pools. They go into traces, so the replay
+ * creates the objects too. */
+void bu_glw_gen_buffers(GLsizei count, GLuint* names);
+void bu_glw_gen_vertex_arrays(GLsizei count, GLuint* names);
+#if BU_GLW_GL_VERSION_AT_LEAST(4, 5)
+void bu_glw_create_buffers(GLsizei count, GLuint* names);
+void bu_glw_create_vertex_arrays(GLsizei count, GLuint* names);
+#endif
+
 /************************* EBO ******************************/
 
 class EBO{
 	GLuint m_ID;
 	GLuint m_draw_mode;
 	unsigned int m_length;
+	GLsizeiptr m_size; /* In bytes, for the memory accounting. */
+
+	/* Used by adopt(). */
+	EBO(GLuint id, GLenum draw_mode, unsigned int length) noexcept : m_ID{id}, m_draw_mode{draw_mode}, m_length{length}, m_size{0}{};
 public:
 	EBO();
 	EBO(const unsigned int* array, GLuint length, GLenum draw_mode);
@@ -230,11 +545,21 @@ public:
 	/* No copy constructor and assignment operator - We don't want multiple instances corresponding to one buffer on the GPU, because that could lead to some spaghetti code.*/
 	EBO(EBO&) = delete;
 	EBO operator=(const EBO&) = delete;
+	/* Moving transfers the ownership of the buffer. The moved-from object holds 0, which glDeleteBuffers ignores. */
+	EBO(EBO&& other) noexcept;
+	EBO& operator=(EBO&& other) noexcept;
+
+	/* Take ownership of an already generated buffer name. Nothing is bound or allocated. */
+	static EBO adopt(GLuint id, GLenum draw_mode = GL_STATIC_DRAW);
+	GLuint id() const { return m_ID; }
+	GLsizeiptr size() const { return m_size; } /* Of the current storage in bytes. */
 
 	void bind();
 	void unbind();
-	void data(unsigned int* data, GLuint length);
-	void partial_data(GLintptr index, unsigned int* data, GLuint length);
+	void data(const unsigned int* data, GLuint length);
+	void partial_data(GLintptr index, const unsigned int* data, GLuint length);
+	/* Specify the storage from untyped memory, e.g. a memory mapped file. size is in bytes. */
+	void raw_data(const void* data, GLsizeiptr size);
 	
 	/* Map the buffer and run the function f on the resulting array. */
 	void map(void (*f)(void* buffer), GLenum mode=GL_READ_WRITE);
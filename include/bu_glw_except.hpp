@@ -49,6 +49,33 @@ public:
 		return what_message.c_str();
 	}
 };
+class BuGlwStaleHandle: public std::exception {
+	std::string what_message = "A handle was used after the object it referred to had been removed from its pool.";
+
+public:
+	const char* what() const noexcept override{
+		return what_message.c_str();
+	}
+};
+
+class BuGlwNullArgument: public std::exception {
+	std::string what_message = "A null pointer was passed where data was expected.";
+
+public:
+	const char* what() const noexcept override{
+		return what_message.c_str();
+	}
+};
+
+class BuGlwBadMeshFile: public std::exception {
+	std::string what_message = "The file is not a valid binary mesh or its contents do not fit inside it.";
+
+public:
+	const char* what() const noexcept override{
+		return what_message.c_str();
+	}
+};
+
 class GLShaderCompilationFailed : public std::exception {
 	std::string what_message = "Failed to compile a shader.";
 public:
@@ -72,6 +99,22 @@ public:
 		return what_message.c_str();
 	}
 };
+class GLUnsupportedFormat : public std::exception {
+	std::string what_message = "The pixel format and type combination is not supported.";
+public:
+	const char* what() const noexcept override{
+		return what_message.c_str();
+	}
+};
+
+class GLFramebufferIncomplete : public std::exception {
+	std::string what_message = "A framebuffer is incomplete or an attachment does not fit the others.";
+public:
+	const char* what() const noexcept override{
+		return what_message.c_str();
+	}
+};
+
 class GLNullPointerReturned : public std::exception {
 	std::string what_message = "An OpenGL function returned null when it was not supposed to.";
 public:
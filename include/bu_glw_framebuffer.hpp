@@ -0,0 +1,159 @@
+/* Framebuffers and render targets for Benoe's Utilities: OpenGL wrappers
+ *
+ * Framebuffer wraps a framebuffer object and checks its attachments. RenderTargetPool hands
+ * out transient render targets for the passes of a frame and takes them back at the end of
+ * it, so the same textures and renderbuffers are reused frame after frame instead of being
+ * allocated and freed by every pass. Passes whose lifetimes do not overlap share targets.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_FRAMEBUFFER_HEADER
+#define BU_GLW_FRAMEBUFFER_HEADER
+
+#include <stdint.h>
+#include <limits.h>
+#include <memory>
+#include <vector>
+#include "bu_glw.hpp"
+
+/* How many frames may a pooled target stay unused before it is freed? */
+#ifndef BU_GLW_RENDER_TARGET_MAX_IDLE_FRAMES
+#define BU_GLW_RENDER_TARGET_MAX_IDLE_FRAMES 3
+#endif
+
+#define BU_GLW_MAX_COLOR_ATTACHMENTS 8
+
+struct RenderTargetDesc{
+	GLsizei width;
+	GLsizei height;
+	GLenum internal_format; /* A sized format, e.g. GL_RGBA16F or GL_DEPTH24_STENCIL8. */
+	GLsizei samples; /* 0 or 1 for no multisampling. */
+	bool sampled; /* A texture if it is to be sampled later, a renderbuffer otherwise. */
+
+	bool operator==(const RenderTargetDesc& other) const{
+		return width == other.width && height == other.height && internal_format == other.internal_format
+			&& (samples > 1 ? samples : 1) == (other.samples > 1 ? other.samples : 1) && sampled == other.sampled;
+	}
+};
+
+/* Estimated bytes per pixel of a sized internal format, 4 if the format is unknown. Drivers may pad, so this is a lower bound. */
+unsigned int bu_glw_internal_format_size(GLenum internal_format);
+/* Does the format go into a depth, stencil or depth-stencil attachment instead of a color one? */
+bool bu_glw_is_depth_format(GLenum internal_format);
+bool bu_glw_is_stencil_format(GLenum internal_format);
+
+/* A texture or a renderbuffer to render into. */
+class RenderTarget{
+	GLuint m_ID;
+	RenderTargetDesc m_desc;
+public:
+	RenderTarget(const RenderTargetDesc& desc);
+	~RenderTarget();
+	RenderTarget(RenderTarget&& other) noexcept;
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	GLuint id() const { return m_ID; }
+	const RenderTargetDesc& desc() const { return m_desc; }
+	bool isTexture() const { return m_desc.sampled; }
+	GLenum textureTarget() const { return m_desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D; }
+	size_t memorySize() const;
+};
+
+class Framebuffer{
+	struct Attachment{
+		GLenum internal_format; /* GL_NONE if nothing is attached. */
+		GLsizei samples;
+	};
+
+	GLuint m_ID;
+	Attachment m_attachments[BU_GLW_MAX_COLOR_ATTACHMENTS + 3]; /* Colors, then depth, stencil, depth-stencil. */
+
+	/* Check the new attachment against the others and remember it. */
+	void attached(GLenum attachment, GLenum internal_format, GLsizei samples);
+	void updateDrawBuffers();
+public:
+	Framebuffer();
+	~Framebuffer();
+	Framebuffer(Framebuffer&& other) noexcept;
+
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+
+	GLuint id() const { return m_ID; }
+
+	/* These bind the framebuffer. They throw GLFramebufferIncomplete if the target can not go to the attachment point
+	 * (e.g. a depth format to a color attachment) or its sample count differs from the earlier attachments. */
+	void attach(GLenum attachment, const RenderTarget& target);
+	void attachTexture(GLenum attachment, GLuint texture, GLenum internal_format, GLsizei samples = 0, GLint level = 0);
+	void detach(GLenum attachment);
+
+	/* Throws GLFramebufferIncomplete if glCheckFramebufferStatus disagrees. */
+	void validate();
+
+	void bind(GLenum target = GL_FRAMEBUFFER);
+	void unbind(GLenum target = GL_FRAMEBUFFER);
+
+	/* Tell the driver the contents of these attachments are not needed any more, so it can skip storing them. Binds the framebuffer. */
+	void discard(const GLenum* attachments, GLsizei count);
+	void discard(GLenum attachment);
+};
+
+struct RenderTargetPoolStats{
+	size_t targets; /* Allocated by the pool, in use or not. */
+	size_t targets_in_use;
+	size_t memory; /* Estimated bytes held by the pool. */
+	size_t peak_memory;
+	uint64_t allocations; /* Since the pool was created. */
+	uint64_t reuses; /* Requests served by an existing target. */
+};
+
+class RenderTargetPool{
+	struct Lease{
+		int first_pass;
+		int last_pass;
+	};
+	struct Entry{
+		RenderTarget target;
+		std::vector<Lease> leases; /* This frame's. */
+		uint64_t last_used_frame;
+		bool written; /* Handed out since it was last invalidated, so it may hold contents of an earlier pass. */
+
+		Entry(const RenderTargetDesc& desc) : target{desc}, last_used_frame{0}, written{false}{};
+	};
+
+	std::vector< std::unique_ptr<Entry> > m_entries;
+	GLuint m_scratch_framebuffer; /* Renderbuffers can only be invalidated through a framebuffer, created on first use. */
+	uint64_t m_frame;
+	unsigned int m_max_idle_frames;
+	size_t m_memory;
+	size_t m_peak_memory;
+	uint64_t m_allocations;
+	uint64_t m_reuses;
+
+	void invalidate(Entry& entry);
+public:
+	RenderTargetPool(unsigned int max_idle_frames = BU_GLW_RENDER_TARGET_MAX_IDLE_FRAMES);
+	~RenderTargetPool();
+
+	RenderTargetPool(const RenderTargetPool&) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+	/* A target for the passes first_pass..last_pass (inclusive) of this frame. A target with the same description is shared
+	 * with other passes as long as their ranges do not overlap, so its contents are undefined at first_pass.
+	 * The reference stays valid until the target is freed by endFrame(), at the earliest max_idle_frames frames later.
+	 * A shared target is invalidated before it is handed out again, so the driver need not keep the earlier pass' contents. */
+	const RenderTarget& acquire(const RenderTargetDesc& desc, int first_pass = 0, int last_pass = INT_MAX);
+	/* Take every target back and invalidate the ones used this frame. Targets unused for more than max_idle_frames frames are freed. */
+	void endFrame();
+	/* Free every target. */
+	void clear();
+
+	RenderTargetPoolStats stats() const;
+	size_t peakMemory() const { return m_peak_memory; }
+};
+
+#endif
@@ -0,0 +1,49 @@
+/* Binary mesh loading for Benoe's Utilities: OpenGL wrappers
+ *
+ * Loads files in the format described in bu_glw_mesh_format.hpp. The file is memory
+ * mapped and the vertex and index blobs are handed to glBufferData directly from the
+ * mapping, the VAO is configured from the attribute table of the header.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_MESH_HEADER
+#define BU_GLW_MESH_HEADER
+
+#include <vector>
+#include "bu_glw.hpp"
+#include "bu_glw_mesh_format.hpp"
+
+/* Check that the header is sane, its attributes are ones glVertexAttribPointer takes and every blob it points to is aligned
+ * and lies inside the file, with counts GL can take.
+ * Throws BuGlwBadMeshFile if not. */
+const MeshFileHeader* bu_glw_mesh_validate(const unsigned char* file, size_t size);
+
+class Mesh{
+	VAO m_vao;
+	VBO m_vbo;
+	EBO m_ebo;
+	GLsizei m_vertex_count;
+	GLsizei m_index_count;
+	std::vector<MeshFileMeshlet> m_meshlets;
+public:
+	/* Leaves the VAO bound. May throw BuGlwBadMeshFile and whatever MappedFile throws. */
+	Mesh(const char* path, GLenum draw_mode = GL_STATIC_DRAW);
+	/* Same, from a file mapped by the caller. */
+	Mesh(const MappedFile& file, GLenum draw_mode = GL_STATIC_DRAW);
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh(Mesh&&) = default;
+
+	void bind();
+	void draw(GLenum mode = GL_TRIANGLES); /* Binds the VAO and draws every index. */
+	void drawMeshlet(size_t index, GLenum mode = GL_TRIANGLES); /* Binds the VAO and draws one meshlet. */
+
+	GLsizei vertexCount() const { return m_vertex_count; }
+	GLsizei indexCount() const { return m_index_count; }
+	const std::vector<MeshFileMeshlet>& meshlets() const { return m_meshlets; }
+};
+
+#endif
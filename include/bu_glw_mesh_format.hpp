@@ -0,0 +1,97 @@
+/* Binary mesh format of Benoe's Utilities: OpenGL wrappers
+ *
+ * A file consists of a MeshFileHeader followed by the vertex blob, the index blob and
+ * optionally a meshlet table, each starting at an offset aligned to BU_GLW_MESH_ALIGNMENT.
+ * The vertex blob is interleaved exactly as a VAO expects it, so it can be handed to
+ * glBufferData straight from a memory mapping. Everything is little endian.
+ *
+ * This header does not depend on OpenGL so tools can use it without a context.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_MESH_FORMAT_HEADER
+#define BU_GLW_MESH_FORMAT_HEADER
+
+#include <stdint.h>
+
+#define BU_GLW_MESH_MAGIC "BUMF"
+#define BU_GLW_MESH_VERSION 1
+#define BU_GLW_MESH_ALIGNMENT 64
+#define BU_GLW_MESH_MAX_ATTRIBUTES 8
+
+/* The values of the matching GL enums, spelled out so no GL header is needed. */
+#define BU_GLW_MESH_BYTE 0x1400
+#define BU_GLW_MESH_UNSIGNED_BYTE 0x1401
+#define BU_GLW_MESH_SHORT 0x1402
+#define BU_GLW_MESH_UNSIGNED_SHORT 0x1403
+#define BU_GLW_MESH_INT 0x1404
+#define BU_GLW_MESH_UNSIGNED_INT 0x1405
+#define BU_GLW_MESH_FLOAT 0x1406
+#define BU_GLW_MESH_DOUBLE 0x140A
+#define BU_GLW_MESH_HALF_FLOAT 0x140B
+
+/* Mirrors VertexAttrib. */
+struct MeshFileAttribute{
+	uint32_t num_fields; /* 1 to 4, like glVertexAttribPointer takes. */
+	uint32_t field_type; /* A GL type enum, e.g. GL_FLOAT. */
+	uint32_t field_size; /* Size of one field in bytes, bu_glw_mesh_type_size(field_type). */
+	uint32_t normalized;
+};
+
+/* A cluster of triangles, a contiguous range of the index blob, with a bounding sphere for culling. */
+struct MeshFileMeshlet{
+	uint32_t index_offset; /* In indices, not bytes. */
+	uint32_t index_count;
+	float center[3];
+	float radius;
+};
+
+struct MeshFileHeader{
+	char magic[4]; /* BU_GLW_MESH_MAGIC, without the terminating zero. */
+	uint32_t version;
+	uint32_t attribute_count;
+	uint32_t vertex_stride; /* In bytes, the sum of the attribute sizes. */
+	uint32_t index_type; /* Always BU_GLW_MESH_UNSIGNED_INT in version 1. */
+	uint32_t meshlet_count;
+	uint64_t vertex_count;
+	uint64_t index_count;
+	/* Byte offsets from the start of the file. */
+	uint64_t vertex_offset;
+	uint64_t index_offset;
+	uint64_t meshlet_offset; /* 0 if meshlet_count is 0. */
+	MeshFileAttribute attributes[BU_GLW_MESH_MAX_ATTRIBUTES];
+};
+
+static_assert(sizeof(MeshFileAttribute) == 16, "MeshFileAttribute must have no padding.");
+static_assert(sizeof(MeshFileMeshlet) == 24, "MeshFileMeshlet must have no padding.");
+static_assert(sizeof(MeshFileHeader) == 192, "MeshFileHeader must have no padding.");
+
+/* Round a byte offset up to the alignment of the blobs. */
+inline uint64_t bu_glw_mesh_align(uint64_t offset){
+	return (offset + BU_GLW_MESH_ALIGNMENT - 1) & ~(uint64_t)(BU_GLW_MESH_ALIGNMENT - 1);
+}
+
+/* Size in bytes of one field of a vertex attribute type, 0 for types attributes can not have. */
+inline uint32_t bu_glw_mesh_type_size(uint32_t type){
+	switch(type){
+		case BU_GLW_MESH_BYTE:
+		case BU_GLW_MESH_UNSIGNED_BYTE:
+			return 1;
+		case BU_GLW_MESH_SHORT:
+		case BU_GLW_MESH_UNSIGNED_SHORT:
+		case BU_GLW_MESH_HALF_FLOAT:
+			return 2;
+		case BU_GLW_MESH_INT:
+		case BU_GLW_MESH_UNSIGNED_INT:
+		case BU_GLW_MESH_FLOAT:
+			return 4;
+		case BU_GLW_MESH_DOUBLE:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+#endif
@@ -0,0 +1,72 @@
+/* Shader permutations for Benoe's Utilities: OpenGL wrappers
+ *
+ * One vertex and one fragment shader source serve many variants of a program.
+ * Each feature bit of a mask turns into a "#define <name> 1" line inserted after the
+ * #version line through the multi-string form of glShaderSource, so the source is
+ * not copied for every variant. Variants are compiled the first time they are requested.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_PERMUTATIONS_HEADER
+#define BU_GLW_PERMUTATIONS_HEADER
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bu_glw.hpp"
+
+#define BU_GLW_MAX_SHADER_FEATURES 64
+/* The most strings PermutationSource::strings() hands out: version line, its newline, one per feature, #line and the rest. */
+#define BU_GLW_MAX_PERMUTATION_STRINGS (BU_GLW_MAX_SHADER_FEATURES + 4)
+
+/* One stage's source, split around its #version line. */
+struct PermutationSource{
+	const char* code;
+	GLint version_length; /* Bytes up to and including the newline after #version. 0 if there is no #version. */
+	char line_directive[24]; /* Restores the line numbers of the source after the injected defines. */
+
+	void split(const char* source);
+	/* The strings to pass to glShaderSource for the defines enabled by mask. strings and lengths need room for
+	 * BU_GLW_MAX_PERMUTATION_STRINGS. Returns how many there are. */
+	GLsizei strings(const std::vector<std::string>& defines, uint64_t mask, const GLchar** strings, GLint* lengths) const;
+};
+
+/* The base sources of a ShaderPermutations, already in memory. */
+struct PermutationSources{
+	const char* vertex;
+	const char* fragment;
+};
+
+class ShaderPermutations{
+	std::string m_vs_code;
+	std::string m_fs_code;
+	PermutationSource m_vs_source;
+	PermutationSource m_fs_source;
+	std::vector<std::string> m_defines; /* "#define <name> 1\n" for each feature bit, built once. */
+	std::unordered_map<uint64_t, ShaderProgram> m_programs;
+
+	void compileStage(Shader& shader, const PermutationSource& source, uint64_t mask);
+public:
+	/* Feature i is enabled by bit i of a mask. The sources are copied, here. Throws BuGlwOutOfBounds for more than 64 features. */
+	ShaderPermutations(const PermutationSources& sources, const char* const* feature_names, unsigned int feature_count);
+	/* Same, with the sources read from files once, here. */
+	ShaderPermutations(const char* vertex_shader_path, const char* fragment_shader_path, const char* const* feature_names, unsigned int feature_count);
+
+	ShaderPermutations(const ShaderPermutations&) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+	/* The program for the given features. Compiled and linked on the first request, cached afterwards. May throw like the ShaderProgram constructors.
+	 * The reference stays valid until the ShaderPermutations is destroyed. */
+	ShaderProgram& get(uint64_t mask);
+	/* Compile the variants known to be needed early, e.g. during loading, so get() never compiles in the middle of a frame. */
+	void warmUp(const uint64_t* masks, size_t count);
+
+	bool isCompiled(uint64_t mask) const { return m_programs.count(mask) != 0; }
+	size_t compiledCount() const { return m_programs.size(); }
+	unsigned int featureCount() const { return (unsigned int)m_defines.size(); }
+};
+
+#endif
@@ -0,0 +1,216 @@
+/* Resource pools for Benoe's Utilities: OpenGL wrappers
+ *
+ * Slot maps which keep the wrapped objects in one dense array, so iterating over
+ * many of them touches contiguous memory. Objects are referred to by handles which
+ * carry a generation, thus a handle to a removed object is detected instead of
+ * silently pointing at whatever took its place.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_POOL_HEADER
+#define BU_GLW_POOL_HEADER
+
+#include <stdint.h>
+#include <new>
+#include <utility>
+#include <vector>
+#include "bu_glw.hpp"
+
+/* How many names should be generated at once when a pool runs out of them? */
+#ifndef BU_GLW_POOL_NAME_BATCH
+#define BU_GLW_POOL_NAME_BATCH 64
+#endif
+
+#define BU_GLW_POOL_NO_SLOT 0xFFFFFFFFu
+
+/* A handle to an object of type T living in a ResourcePool<T>. It is only a pair of integers, copy it freely. */
+template<typename T>
+struct ResourceHandle{
+	uint32_t index;
+	uint32_t generation;
+};
+
+template<typename T>
+class ResourcePool{
+	/* While a slot is in use dense_index points into m_objects, while it is free it holds the next free slot. */
+	struct Slot{
+		uint32_t dense_index;
+		uint32_t generation;
+	};
+
+	std::vector<T> m_objects;
+	std::vector<uint32_t> m_owners; /* The slot of each object in m_objects. */
+	std::vector<Slot> m_slots;
+	uint32_t m_free_head;
+
+public:
+	ResourcePool() : m_free_head{BU_GLW_POOL_NO_SLOT}{};
+
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+
+	/* Move an object into the pool. */
+	ResourceHandle<T> insert(T&& object){
+		m_objects.push_back(std::move(object));
+		return claim_slot();
+	}
+
+	/* Construct an object in place inside the pool. */
+	template<typename... Args>
+	ResourceHandle<T> emplace(Args&&... args){
+		m_objects.emplace_back(std::forward<Args>(args)...);
+		return claim_slot();
+	}
+
+	bool valid(ResourceHandle<T> handle) const{
+		return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation;
+	}
+
+	/* Returns nullptr if the handle is stale. */
+	T* get(ResourceHandle<T> handle){
+		if(!valid(handle))
+			return nullptr;
+		return &m_objects[ m_slots[handle.index].dense_index ];
+	}
+
+	const T* get(ResourceHandle<T> handle) const{
+		if(!valid(handle))
+			return nullptr;
+		return &m_objects[ m_slots[handle.index].dense_index ];
+	}
+
+	/* Same as get, but throws BuGlwStaleHandle instead of returning nullptr. */
+	T& at(ResourceHandle<T> handle){
+		T* object = get(handle);
+		if(object == nullptr)
+			throw( BuGlwStaleHandle() );
+		return *object;
+	}
+
+	/* Destroy the object (and thus its GPU resource). The last object is moved into its place to keep the array dense.
+	 * Removing with a stale handle does nothing. */
+	void remove(ResourceHandle<T> handle){
+		if(!valid(handle))
+			return;
+		Slot& slot = m_slots[handle.index];
+		uint32_t dense = slot.dense_index;
+		uint32_t last = (uint32_t)m_objects.size() - 1;
+
+		if(dense != last){
+			/* Objects are only required to be move constructible (ShaderProgram can not be assigned), hence the placement new. */
+			m_objects[dense].~T();
+			new (&m_objects[dense]) T(std::move(m_objects[last]));
+			m_owners[dense] = m_owners[last];
+			m_slots[ m_owners[dense] ].dense_index = dense;
+		}
+		m_objects.pop_back();
+		m_owners.pop_back();
+
+		slot.generation++;
+		slot.dense_index = m_free_head;
+		m_free_head = handle.index;
+	}
+
+	/* Destroy every object. Every handle handed out so far becomes stale. */
+	void clear(){
+		while(!m_objects.empty()){
+			uint32_t slot = m_owners.back();
+			m_objects.pop_back();
+			m_owners.pop_back();
+			m_slots[slot].generation++;
+			m_slots[slot].dense_index = m_free_head;
+			m_free_head = slot;
+		}
+	}
+
+	void reserve(size_t count){
+		m_objects.reserve(count);
+		m_owners.reserve(count);
+		m_slots.reserve(count);
+	}
+
+	size_t size() const { return m_objects.size(); }
+	bool empty() const { return m_objects.empty(); }
+
+	/* Iteration goes over the dense array. The order changes whenever an object is removed. */
+	T* begin() { return m_objects.data(); }
+	T* end() { return m_objects.data() + m_objects.size(); }
+	const T* begin() const { return m_objects.data(); }
+	const T* end() const { return m_objects.data() + m_objects.size(); }
+
+private:
+	/* Assign a slot to the object just appended to m_objects. */
+	ResourceHandle<T> claim_slot(){
+		uint32_t dense = (uint32_t)m_objects.size() - 1;
+		uint32_t index;
+		if(m_free_head != BU_GLW_POOL_NO_SLOT){
+			index = m_free_head;
+			m_free_head = m_slots[index].dense_index;
+			m_slots[index].dense_index = dense;
+		}else{
+			index = (uint32_t)m_slots.size();
+			m_slots.push_back( Slot{dense, 0} );
+		}
+		m_owners.push_back(index);
+		return ResourceHandle<T>{ index, m_slots[index].generation };
+	}
+};
+
+/* Names generated in bulk, handed out one by one. Names left unused are deleted with the reserve. */
+enum GLNameKind{
+	BU_GLW_BUFFER_NAMES,
+	BU_GLW_VERTEX_ARRAY_NAMES
+};
+
+class GLNameReserve{
+	std::vector<GLuint> m_names;
+	GLNameKind m_kind;
+	GLsizei m_batch;
+public:
+	GLNameReserve(GLNameKind kind, GLsizei batch = BU_GLW_POOL_NAME_BATCH);
+	~GLNameReserve();
+
+	GLNameReserve(const GLNameReserve&) = delete;
+	GLNameReserve& operator=(const GLNameReserve&) = delete;
+
+	GLuint take(); /* Generates a new batch if the reserve is empty. */
+	void generate(GLsizei count); /* Generate count names with a single GL call. */
+	size_t available() const { return m_names.size(); }
+};
+
+class VBOPool : public ResourcePool<VBO>{
+	GLNameReserve m_names;
+public:
+	VBOPool(GLsizei name_batch = BU_GLW_POOL_NAME_BATCH) : m_names{BU_GLW_BUFFER_NAMES, name_batch}{};
+
+	ResourceHandle<VBO> create(GLenum draw_mode = GL_STATIC_DRAW);
+	ResourceHandle<VBO> create(const float* array, GLuint length, GLenum draw_mode = GL_STATIC_DRAW);
+	/* Reserve room for count more buffers, including their names. */
+	void prepare(GLsizei count);
+};
+
+class EBOPool : public ResourcePool<EBO>{
+	GLNameReserve m_names;
+public:
+	EBOPool(GLsizei name_batch = BU_GLW_POOL_NAME_BATCH) : m_names{BU_GLW_BUFFER_NAMES, name_batch}{};
+
+	ResourceHandle<EBO> create(GLenum draw_mode = GL_STATIC_DRAW);
+	ResourceHandle<EBO> create(const unsigned int* array, GLuint length, GLenum draw_mode = GL_STATIC_DRAW);
+	void prepare(GLsizei count);
+};
+
+class VAOPool : public ResourcePool<VAO>{
+	GLNameReserve m_names;
+public:
+	VAOPool(GLsizei name_batch = BU_GLW_POOL_NAME_BATCH) : m_names{BU_GLW_VERTEX_ARRAY_NAMES, name_batch}{};
+
+	ResourceHandle<VAO> create();
+	void prepare(GLsizei count);
+};
+
+/* Programs can not be generated in bulk, use emplace() with the arguments of a ShaderProgram constructor. */
+typedef ResourcePool<ShaderProgram> ShaderProgramPool;
+
+#endif
@@ -0,0 +1,141 @@
+/* Asynchronous framebuffer readback for Benoe's Utilities: OpenGL wrappers
+ *
+ * glReadPixels into client memory waits for the GPU to finish the frame. Here frames are
+ * read into a ring of GL_PIXEL_PACK_BUFFERs instead, a fence is inserted after every read
+ * and the buffer is only mapped a few frames later, once the fence has signaled. The mapped
+ * memory is handed to a consumer callback on a worker thread without being copied.
+ *
+ * Every member function has to be called on the thread owning the GL context, except
+ * stats() which may be called from anywhere.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_READBACK_HEADER
+#define BU_GLW_READBACK_HEADER
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bu_glw.hpp"
+
+/* A view of a frame still inside a mapped pack buffer. It is only valid during the callback. */
+struct ReadbackFrame{
+	const unsigned char* data; /* The first row. If the frame is flipped this is the top row, stored last in the buffer. */
+	ptrdiff_t stride; /* Bytes from one row to the next, negative for flipped frames. */
+	GLsizei width;
+	GLsizei height;
+	GLenum format;
+	GLenum type;
+	uint64_t frame_number; /* Counts captures, dropped ones included. */
+
+	const unsigned char* row(GLsizei y) const { return data + stride * y; }
+};
+
+/* Called on the worker thread for every frame, in capture order. */
+typedef void (*ReadbackCallback)(const ReadbackFrame& frame, void* user_data);
+
+struct ReadbackOptions{
+	/* Conversion done by glReadPixels while packing, e.g. GL_BGRA for encoders expecting it or GL_RED for a single channel. */
+	GLenum format;
+	GLenum type;
+	unsigned int ring_size; /* Number of pack buffers. */
+	unsigned int latency_frames; /* A buffer is mapped at the earliest this many captures after it was filled. Must be below ring_size. */
+	bool flip_vertically; /* Present rows top to bottom instead of OpenGL's bottom to top. Costs nothing, only the view changes. */
+	bool drop_when_full; /* Skip a capture instead of waiting when every buffer is still in use. */
+
+	ReadbackOptions() :
+		format{GL_RGBA},
+		type{GL_UNSIGNED_BYTE},
+		ring_size{4},
+		latency_frames{2},
+		flip_vertically{true},
+		drop_when_full{false}
+	{};
+};
+
+struct ReadbackStats{
+	uint64_t frames_captured;
+	uint64_t frames_delivered;
+	uint64_t frames_dropped;
+	uint64_t bytes_delivered;
+	double average_latency_ms; /* From capture until the callback is called. */
+	double max_latency_ms;
+	double average_callback_ms; /* Time spent inside the callback. */
+	double frames_per_second; /* Delivered frames since the first capture. */
+	double megabytes_per_second;
+};
+
+class FrameReadback{
+	enum SlotState{
+		BU_GLW_SLOT_FREE,
+		BU_GLW_SLOT_PENDING, /* Read issued, waiting for the fence. */
+		BU_GLW_SLOT_MAPPED, /* Handed to the worker. */
+		BU_GLW_SLOT_CONSUMED /* The worker is done, has to be unmapped on the GL thread. */
+	};
+
+	struct Slot{
+		GLuint buffer;
+		GLsizeiptr capacity;
+		GLsync fence;
+		std::atomic<int> state;
+		ReadbackFrame frame;
+		GLsizeiptr size;
+		std::chrono::steady_clock::time_point capture_time;
+	};
+
+	ReadbackOptions m_options;
+	ReadbackCallback m_callback;
+	void* m_user_data;
+	std::vector<Slot> m_slots;
+	unsigned int m_head; /* Next slot to capture into. */
+	unsigned int m_tail; /* Oldest slot not yet handed to the worker. */
+	uint64_t m_frame_number;
+
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_work_ready;
+	std::condition_variable m_work_done;
+	std::deque<unsigned int> m_queue;
+	bool m_stopping;
+
+	mutable std::mutex m_stats_mutex;
+	ReadbackStats m_stats;
+	double m_total_latency_ms;
+	double m_total_callback_ms;
+	std::chrono::steady_clock::time_point m_first_capture;
+
+	void work();
+	void unmapConsumed();
+	void resolve(bool block);
+	void waitForSlot(Slot& slot);
+public:
+	FrameReadback(ReadbackCallback callback, void* user_data = nullptr, const ReadbackOptions& options = ReadbackOptions());
+	/* Delivers every frame still in flight before returning. Does not throw, if delivering fails the frames left are dropped. */
+	~FrameReadback();
+
+	FrameReadback(const FrameReadback&) = delete;
+	FrameReadback& operator=(const FrameReadback&) = delete;
+
+	/* Read a rectangle of the framebuffer bound to GL_READ_FRAMEBUFFER into the next buffer of the ring, then hand over any
+	 * earlier frame which is ready. Call once per frame. Returns false if the frame was dropped. May throw GLUnsupportedFormat,
+	 * and throws BuGlwOutOfBounds if width or height is not positive. */
+	bool capture(GLint x, GLint y, GLsizei width, GLsizei height);
+	/* Hand over ready frames without capturing, e.g. while nothing is rendered. */
+	void poll();
+	/* Block until every captured frame has been delivered. */
+	void flush();
+
+	ReadbackStats stats() const;
+};
+
+/* Bytes per pixel for a format/type pair accepted by glReadPixels, 0 if unsupported. */
+unsigned int bu_glw_pixel_size(GLenum format, GLenum type);
+
+#endif
@@ -0,0 +1,117 @@
+/* Buffer residency management for Benoe's Utilities: OpenGL wrappers
+ *
+ * Keeps the storage of registered VBOs and EBOs within a memory budget. Buffers which have
+ * not been drawn for the longest time lose their storage first; their names stay, so VAOs
+ * referring to them remain valid. The data is restored from a copy kept on the cpu or from
+ * memory the caller keeps around (e.g. a MappedFile) the next time the buffer is used, with
+ * at most a given number of bytes uploaded per frame. Buffers are registered by their handles
+ * in a VBOPool or EBOPool, so the pools stay free to move them around.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_RESIDENCY_HEADER
+#define BU_GLW_RESIDENCY_HEADER
+
+#include <stdint.h>
+#include <vector>
+#include "bu_glw.hpp"
+#include "bu_glw_pool.hpp"
+
+enum ResidencyBacking{
+	BU_GLW_BACKING_COPY, /* The manager copies the data and keeps the copy. */
+	BU_GLW_BACKING_BORROWED /* The data stays where it is and must outlive the registration, e.g. inside a MappedFile. */
+};
+
+/* Handle to a registered buffer. Stale handles are detected through the generation. */
+struct ResidentBuffer{
+	uint32_t index;
+	uint32_t generation;
+};
+
+struct ResidencyStats{
+	size_t budget;
+	size_t resident_bytes;
+	size_t peak_resident_bytes;
+	size_t registered_bytes; /* What everything would take if it were resident. */
+	size_t resident_buffers;
+	size_t registered_buffers;
+	size_t uploaded_this_frame;
+	uint64_t uploads;
+	uint64_t bytes_uploaded;
+	uint64_t evictions;
+	uint64_t bytes_evicted;
+	uint64_t deferred_uploads; /* Uses which found the frame's upload budget spent. */
+	uint64_t over_budget_uploads; /* Uploads which could not evict enough, because everything resident was used in the same frame. */
+};
+
+class ResidencyManager{
+	/* Buffers are looked up through their pool every time, as the pool moves them around when others are removed or added. */
+	struct Entry{
+		VBOPool* vbo_pool; /* Exactly one of the pools is set. */
+		EBOPool* ebo_pool;
+		ResourceHandle<VBO> vbo;
+		ResourceHandle<EBO> ebo;
+		const void* data;
+		size_t size;
+		uint64_t last_used_frame;
+		uint32_t generation;
+		uint32_t previous; /* Neighbours in the LRU list of resident buffers, the head being the most recently used. */
+		uint32_t next;
+		bool alive;
+		bool owns_data;
+		bool resident;
+		bool requested;
+	};
+
+	std::vector<Entry> m_entries;
+	std::vector<uint32_t> m_free_entries;
+	std::vector<uint32_t> m_requests; /* Deferred uploads, in the order they were asked for. */
+	uint32_t m_lru_head;
+	uint32_t m_lru_tail;
+	size_t m_upload_budget;
+	uint64_t m_frame;
+	ResidencyStats m_stats;
+
+	ResidentBuffer add(VBOPool* vbo_pool, ResourceHandle<VBO> vbo, EBOPool* ebo_pool, ResourceHandle<EBO> ebo,
+	                   const void* data, size_t size, ResidencyBacking backing);
+	Entry* find(ResidentBuffer buffer);
+	bool pooled(const Entry& entry) const; /* Whether the buffer is still in its pool. */
+	void store(Entry& entry, const void* data, size_t size);
+	void link(uint32_t index);
+	void unlink(uint32_t index);
+	void upload(uint32_t index);
+	void evict(uint32_t index);
+	/* Evict least recently used buffers, not used this frame, until size more bytes fit. Returns false if they can not. */
+	bool makeRoom(size_t size);
+public:
+	/* budget and upload_budget are in bytes. An upload larger than upload_budget is still done if it is the first one of a frame. */
+	ResidencyManager(size_t budget, size_t upload_budget);
+	~ResidencyManager();
+
+	ResidencyManager(const ResidencyManager&) = delete;
+	ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+	/* Register a buffer of a pool with the data it should hold. Its current storage is dropped, the data is uploaded on first use.
+	 * The pool must outlive the registration, remove the buffer here before removing it from the pool.
+	 * Throws BuGlwStaleHandle for stale pool handles and BuGlwNullArgument if data is null but size is not 0. */
+	ResidentBuffer add(VBOPool& pool, ResourceHandle<VBO> vbo, const void* data, size_t size, ResidencyBacking backing = BU_GLW_BACKING_COPY);
+	ResidentBuffer add(EBOPool& pool, ResourceHandle<EBO> ebo, const void* data, size_t size, ResidencyBacking backing = BU_GLW_BACKING_COPY);
+	/* Forget the buffer. It keeps whatever storage it has. Removing with a stale handle does nothing. */
+	void remove(ResidentBuffer buffer);
+
+	/* Call before drawing with the buffer. Marks it as used this frame and uploads it if needed and the frame's upload budget allows it.
+	 * Returns false if it is not resident, in which case the draw should be skipped; the upload happens in a later frame.
+	 * Throws BuGlwStaleHandle for stale handles, and if the buffer was removed from its pool while registered. */
+	bool use(ResidentBuffer buffer);
+	bool isResident(ResidentBuffer buffer);
+
+	/* Call once per frame. Evicts down to the budget, then uploads deferred buffers within the next frame's upload budget. */
+	void endFrame();
+	void setBudget(size_t budget);
+
+	ResidencyStats stats() const { return m_stats; }
+};
+
+#endif
@@ -0,0 +1,138 @@
+/* Trace writing and reading for Benoe's Utilities: OpenGL wrappers
+ *
+ * TraceWriter turns records into the file format of bu_glw_trace_format.hpp; the wrappers
+ * feed one when built with BU_GLW_TRACE. bu_glw_trace_parse() splits such a file back into
+ * records for the replayer. Neither needs OpenGL, so both can be tested without a context.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_TRACE_HEADER
+#define BU_GLW_TRACE_HEADER
+
+#include <stdio.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "bu_glw_except.hpp"
+#include "bu_glw_trace_format.hpp"
+
+/* Bytes collected by the recording threads before they are handed to the writer thread. */
+#ifndef BU_GLW_TRACE_CHUNK_SIZE
+#define BU_GLW_TRACE_CHUNK_SIZE (1 << 20)
+#endif
+
+/* Bytes of payloads kept to recognize repeated content. Beyond it the oldest are forgotten, and written again if they come back. */
+#ifndef BU_GLW_TRACE_PAYLOAD_MEMORY
+#define BU_GLW_TRACE_PAYLOAD_MEMORY (64 << 20)
+#endif
+
+/******************************* Writing ********************************/
+
+typedef uint64_t (*TraceHashFunction)(const void* data, size_t size);
+
+/* Collects records into chunks and writes them to the file from a thread of its own.
+ * Records may come from any thread, and begin() and end() may be called from any thread too;
+ * a record made while end() runs either makes it into the file whole or not at all. */
+class TraceWriter{
+	struct PayloadKey{
+		uint64_t hash;
+		uint64_t size;
+		bool operator==(const PayloadKey& other) const { return hash == other.hash && size == other.size; };
+	};
+	struct PayloadKeyHash{
+		size_t operator()(const PayloadKey& key) const { return (size_t)(key.hash ^ key.size); };
+	};
+	struct StoredPayload{
+		uint64_t id;
+		std::vector<unsigned char> bytes;
+		bool kept; /* Whether bytes still holds the content. Once forgotten, only the id is left, so it is not handed out again. */
+	};
+	struct KeptPayload{
+		PayloadKey key;
+		size_t index; /* In the candidates of the key. */
+	};
+
+	TraceHashFunction m_hash;
+	FILE* m_file;
+	std::vector<unsigned char> m_chunk; /* Being filled by the recording threads. */
+	std::deque< std::vector<unsigned char> > m_full; /* Waiting for the writer. */
+	std::vector< std::vector<unsigned char> > m_spare; /* Written ones, kept to reuse their memory. */
+	/* Every payload in the trace, so equal content is stored once while it is kept. Different content with the same hash gets another id. */
+	std::unordered_map< PayloadKey, std::vector<StoredPayload>, PayloadKeyHash > m_payloads;
+	std::unordered_set<uint64_t> m_payload_ids;
+	std::deque<KeptPayload> m_kept; /* Payloads whose bytes are kept, oldest first. */
+	size_t m_kept_bytes;
+	size_t m_payload_memory;
+	std::mutex m_mutex; /* Guards everything above and m_stopping. */
+	std::mutex m_control; /* Serializes begin() and end(). */
+	std::condition_variable m_ready;
+	std::thread m_writer;
+	std::atomic<bool> m_enabled;
+	bool m_stopping;
+	bool m_failed; /* Only touched by the writer thread until it is joined. */
+
+	void writeLoop();
+	void handOff();
+	void append(const void* data, size_t size);
+	uint64_t payload(const void* data, size_t size);
+	void keep(const PayloadKey& key, const void* data, size_t size);
+	void stop();
+
+public:
+	/* hash is only replaceable so tests can force collisions. payload_memory caps the bytes kept to recognize repeats. */
+	TraceWriter(TraceHashFunction hash = bu_glw_trace_hash, size_t payload_memory = BU_GLW_TRACE_PAYLOAD_MEMORY);
+	/* Ends the capture, without throwing if writing failed. */
+	~TraceWriter();
+
+	TraceWriter(const TraceWriter&) = delete;
+	TraceWriter& operator=(const TraceWriter&) = delete;
+
+	/* Start capturing into the file, after ending the capture in progress. Throws BuGlwIOError if it can not be opened. */
+	void begin(const char* path);
+	/* Stop capturing and wait for everything to be written. Throws BuGlwIOError if writing failed. */
+	void end();
+	/* One relaxed load, for skipping the work of building records. */
+	bool enabled() const { return m_enabled.load(std::memory_order_relaxed); };
+
+	/* Append a record of count words. Does nothing unless capturing. */
+	void record(TraceOpcode opcode, const uint32_t* words, unsigned int count);
+	/* Same, for a record referring to size bytes of data. The data is stored as a payload first, unless the trace already
+	 * has the same bytes, and its id is written into words[at] and words[at + 1]. No data gives id 0. */
+	void record(TraceOpcode opcode, uint32_t* words, unsigned int count, unsigned int at, const void* data, size_t size);
+	/* Append a frame marker and hand what was collected to the writer. */
+	void frame();
+};
+
+/******************************* Reading ********************************/
+
+struct TraceRecord{
+	const uint32_t* words;
+	uint16_t opcode;
+	uint16_t count;
+};
+
+struct TracePayload{
+	const unsigned char* data;
+	uint64_t size;
+};
+
+/* A trace split into its parts. Points into the data it was parsed from, which has to outlive it. */
+struct TraceContents{
+	std::vector<TraceRecord> records; /* Without the payloads and frame markers. */
+	std::vector<size_t> frame_ends; /* Index one past the last record of every frame. */
+	std::unordered_map<uint64_t, TracePayload> payloads; /* By id. */
+};
+
+/* Split a whole trace file. data has to be 4 byte aligned, as anything from malloc or mmap is.
+ * A trace that was cut short is parsed up to where it ends. Returns false, after printing why, if it is not a trace. */
+bool bu_glw_trace_parse(const unsigned char* data, size_t size, TraceContents& contents);
+
+#endif
@@ -0,0 +1,139 @@
+/* Binary trace format of Benoe's Utilities: OpenGL wrappers
+ *
+ * A trace is a TraceFileHeader followed by records. Every record is a TraceRecordHeader
+ * followed by `words` 32 bit words, whose meaning depends on the opcode (see below).
+ * 64 bit values take two words, the low one first. Object names are the ones the
+ * capturing process got from the driver; the replayer maps them to its own.
+ *
+ * Bulk data (buffer contents, shader sources, uniform names) is stored in a PAYLOAD record
+ * and referred to by its 64 bit id afterwards; id 0 means no data. Repeated content is
+ * usually referred to by the same id, but may be stored again under another one when the
+ * writer no longer remembers it. The id is the hash of the bytes, unless another payload
+ * with the same hash came first, then it is the next free one. A PAYLOAD record is followed
+ * by its bytes, padded to a multiple of 4.
+ * Everything is little endian.
+ *
+ * This header does not depend on OpenGL so tools can use it without a context.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_TRACE_FORMAT_HEADER
+#define BU_GLW_TRACE_FORMAT_HEADER
+
+#include <stdint.h>
+#include <string.h>
+
+#define BU_GLW_TRACE_MAGIC "BUGT"
+#define BU_GLW_TRACE_VERSION 2
+
+/* Values of TraceUniform.type */
+#define BU_GLW_TRACE_UNIFORM_FLOAT 0
+#define BU_GLW_TRACE_UNIFORM_INT 1
+#define BU_GLW_TRACE_UNIFORM_UINT 2
+
+/* The words of each record, in order. */
+enum TraceOpcode{
+	BU_GLW_TRACE_PAYLOAD = 1,        /* id(2), size(2), then the bytes. */
+	BU_GLW_TRACE_FRAME,              /* Nothing. Ends a frame. */
+
+	BU_GLW_TRACE_CREATE_BUFFER,      /* buffer. A new name from glGenBuffers or glCreateBuffers. */
+	BU_GLW_TRACE_BIND_BUFFER,        /* target, buffer */
+	BU_GLW_TRACE_BIND_BUFFER_BASE,   /* target, index, buffer */
+	BU_GLW_TRACE_BIND_BUFFER_RANGE,  /* target, index, buffer, offset(2), size(2) */
+	BU_GLW_TRACE_BUFFER_DATA,        /* target, buffer, usage, size(2), payload(2). Binds the buffer. */
+	BU_GLW_TRACE_BUFFER_SUB_DATA,    /* target, buffer, offset(2), size(2), payload(2). Binds the buffer. */
+	BU_GLW_TRACE_DELETE_BUFFER,      /* buffer */
+
+	BU_GLW_TRACE_CREATE_VERTEX_ARRAY, /* vertex array. A new name from glGenVertexArrays or glCreateVertexArrays. */
+	BU_GLW_TRACE_BIND_VERTEX_ARRAY,  /* vertex array */
+	BU_GLW_TRACE_VERTEX_ATTRIB,      /* index, size, type, normalized, stride, offset(2). Enables the attribute too. */
+	BU_GLW_TRACE_DELETE_VERTEX_ARRAY, /* vertex array */
+
+	BU_GLW_TRACE_SHADER_SOURCE,      /* shader, type, payload(2). Compiles it too. */
+	BU_GLW_TRACE_DELETE_SHADER,      /* shader */
+	BU_GLW_TRACE_ATTACH_SHADER,      /* program, shader */
+	BU_GLW_TRACE_LINK_PROGRAM,       /* program, separable */
+	BU_GLW_TRACE_STAGE_PROGRAM,      /* program, type, payload(2). A separable program made with glCreateShaderProgramv. */
+	BU_GLW_TRACE_USE_PROGRAM,        /* program */
+	BU_GLW_TRACE_DELETE_PROGRAM,     /* program */
+	BU_GLW_TRACE_UNIFORM_LOCATION,   /* program, location, name payload(2). Locations may differ between drivers. */
+	BU_GLW_TRACE_UNIFORM,            /* program, location, type, count, separable, value[4]. Plain glUniform* unless separable. */
+
+	BU_GLW_TRACE_PIPELINE_STAGES,    /* pipeline, stage bits, program */
+	BU_GLW_TRACE_BIND_PIPELINE,      /* pipeline */
+	BU_GLW_TRACE_DELETE_PIPELINE,    /* pipeline */
+
+	BU_GLW_TRACE_DRAW_ARRAYS,        /* mode, first, count */
+	BU_GLW_TRACE_DRAW_ELEMENTS,      /* mode, count, type, offset(2) */
+	BU_GLW_TRACE_DISPATCH,           /* program, x, y, z. Uses the program too. */
+	BU_GLW_TRACE_DISPATCH_INDIRECT,  /* program, offset(2). Uses the program too. */
+	BU_GLW_TRACE_MEMORY_BARRIER,     /* barriers */
+
+	BU_GLW_TRACE_OPCODE_COUNT
+};
+
+struct TraceFileHeader{
+	char magic[4]; /* BU_GLW_TRACE_MAGIC, without the terminating zero. */
+	uint32_t version;
+};
+
+struct TraceRecordHeader{
+	uint16_t opcode;
+	uint16_t words;
+};
+
+static_assert(sizeof(TraceFileHeader) == 8, "TraceFileHeader must have no padding.");
+static_assert(sizeof(TraceRecordHeader) == 4, "TraceRecordHeader must have no padding.");
+
+/* How many words a record of the opcode has at least, 0 for unknown opcodes. */
+static inline unsigned int bu_glw_trace_opcode_words(unsigned int opcode){
+	static const unsigned char words[BU_GLW_TRACE_OPCODE_COUNT] = {
+		0, 4, 0,
+		1, 2, 3, 7, 7, 8, 1,
+		1, 1, 7, 1,
+		4, 1, 2, 2, 4, 1, 1, 4, 9,
+		3, 1, 1,
+		3, 5, 4, 3, 1
+	};
+	return opcode < BU_GLW_TRACE_OPCODE_COUNT ? words[opcode] : 0;
+}
+
+static inline const char* bu_glw_trace_opcode_name(unsigned int opcode){
+	static const char* const names[BU_GLW_TRACE_OPCODE_COUNT] = {
+		"invalid", "payload", "frame",
+		"create_buffer", "bind_buffer", "bind_buffer_base", "bind_buffer_range", "buffer_data", "buffer_sub_data", "delete_buffer",
+		"create_vertex_array", "bind_vertex_array", "vertex_attrib", "delete_vertex_array",
+		"shader_source", "delete_shader", "attach_shader", "link_program", "stage_program", "use_program", "delete_program",
+		"uniform_location", "uniform",
+		"pipeline_stages", "bind_pipeline", "delete_pipeline",
+		"draw_arrays", "draw_elements", "dispatch", "dispatch_indirect", "memory_barrier"
+	};
+	return opcode < BU_GLW_TRACE_OPCODE_COUNT ? names[opcode] : "unknown";
+}
+
+static inline uint64_t bu_glw_trace_join(uint32_t low, uint32_t high){
+	return (uint64_t)low | ((uint64_t)high << 32);
+}
+
+/* Hash of a payload, never 0. Not cryptographic, but the size is mixed in as well. */
+static inline uint64_t bu_glw_trace_hash(const void* data, size_t size){
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 0xcbf29ce484222325ull ^ ((uint64_t)size * 0x9e3779b97f4a7c15ull);
+	size_t i = 0;
+	for(; i + 8 <= size; i += 8){
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * 0x100000001b3ull;
+		hash ^= hash >> 29;
+	}
+	for(; i < size; ++i)
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash != 0 ? hash : 1;
+}
+
+#endif
@@ -6,7 +6,13 @@
  * 2022 - present: Thomas Benoe */
 
 #include "bu_glw.hpp"
+#include "bu_glw_trace_format.hpp"
 #include <string.h>
+#include <atomic>
+#if BU_GLW_TRACE
+#include <string>
+#include "bu_glw_trace.hpp"
+#endif
 #ifdef __linux__
 #include <unistd.h>
 #include <sys/stat.h>
@@ -16,10 +22,239 @@
 #include <stdio.h>
 #endif
 
+/********************** Memory accounting *******************/
+
+static std::atomic<int64_t> bu_glw_memory_bytes[BU_GLW_MEMORY_CATEGORY_COUNT];
+static std::atomic<int64_t> bu_glw_memory_peak_bytes[BU_GLW_MEMORY_CATEGORY_COUNT];
+static std::atomic<uint64_t> bu_glw_memory_allocations[BU_GLW_MEMORY_CATEGORY_COUNT];
+static std::atomic<int64_t> bu_glw_memory_total_bytes;
+static std::atomic<int64_t> bu_glw_memory_peak_total_bytes;
+
+static void bu_glw_raise_peak(std::atomic<int64_t>& peak, int64_t value){
+	int64_t current = peak.load(std::memory_order_relaxed);
+	while(value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+void bu_glw_memory_track(GpuMemoryCategory category, int64_t old_size, int64_t new_size){
+	int64_t delta = new_size - old_size;
+	if(new_size != 0)
+		bu_glw_memory_allocations[category].fetch_add(1, std::memory_order_relaxed);
+	if(delta == 0)
+		return;
+	int64_t bytes = bu_glw_memory_bytes[category].fetch_add(delta, std::memory_order_relaxed) + delta;
+	int64_t total = bu_glw_memory_total_bytes.fetch_add(delta, std::memory_order_relaxed) + delta;
+	bu_glw_raise_peak(bu_glw_memory_peak_bytes[category], bytes);
+	bu_glw_raise_peak(bu_glw_memory_peak_total_bytes, total);
+}
+
+GpuMemoryStats bu_glw_memory_stats(){
+	GpuMemoryStats stats;
+	for(int i = 0; i < BU_GLW_MEMORY_CATEGORY_COUNT; ++i){
+		stats.bytes[i] = bu_glw_memory_bytes[i].load(std::memory_order_relaxed);
+		stats.peak_bytes[i] = bu_glw_memory_peak_bytes[i].load(std::memory_order_relaxed);
+		stats.allocations[i] = bu_glw_memory_allocations[i].load(std::memory_order_relaxed);
+	}
+	stats.total_bytes = bu_glw_memory_total_bytes.load(std::memory_order_relaxed);
+	stats.peak_total_bytes = bu_glw_memory_peak_total_bytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+const char* bu_glw_memory_category_name(GpuMemoryCategory category){
+	switch(category){
+		case BU_GLW_MEMORY_VERTEX_BUFFERS:   return "vertex buffers";
+		case BU_GLW_MEMORY_INDEX_BUFFERS:    return "index buffers";
+		case BU_GLW_MEMORY_STORAGE_BUFFERS:  return "storage buffers";
+		case BU_GLW_MEMORY_READBACK_BUFFERS: return "readback buffers";
+		case BU_GLW_MEMORY_RENDER_TARGETS:   return "render targets";
+		case BU_GLW_MEMORY_CATEGORY_COUNT:   break;
+	}
+	return "unknown";
+}
+
+/* Record the new size of a buffer's storage. */
+static inline void bu_glw_buffer_resized(GpuMemoryCategory category, GLsizeiptr& size, GLsizeiptr new_size){
+#if BU_GLW_TRACK_MEMORY
+	bu_glw_memory_track(category, size, new_size);
+#else
+	(void)category;
+#endif
+	size = new_size;
+}
+
+/************************** Tracing *************************/
+
+static inline uint32_t bu_glw_low(uint64_t value){ return (uint32_t)value; }
+static inline uint32_t bu_glw_high(uint64_t value){ return (uint32_t)(value >> 32); }
+
+#if BU_GLW_TRACE
+
+/* Shared by every thread issuing wrapper calls. Idle unless capturing. */
+static TraceWriter bu_glw_tracer;
+
+/* Record a wrapper operation if capturing. Every argument becomes one word. */
+template<typename... Words>
+static inline void bu_glw_trace(TraceOpcode opcode, Words... words){
+	if(!bu_glw_tracer.enabled())
+		return;
+	uint32_t packed[sizeof...(Words) + 1] = {(uint32_t)words...};
+	bu_glw_tracer.record(opcode, packed, sizeof...(Words));
+}
+
+static inline void bu_glw_trace_buffer_data(GLenum target, GLuint buffer, GLenum usage, GLsizeiptr size, const void* data){
+	if(!bu_glw_tracer.enabled())
+		return;
+	uint32_t words[7] = {target, buffer, usage, bu_glw_low(size), bu_glw_high(size), 0, 0};
+	bu_glw_tracer.record(BU_GLW_TRACE_BUFFER_DATA, words, 7, 5, data, size);
+}
+
+static inline void bu_glw_trace_buffer_sub_data(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data){
+	if(!bu_glw_tracer.enabled())
+		return;
+	uint32_t words[8] = {target, buffer, bu_glw_low(offset), bu_glw_high(offset), bu_glw_low(size), bu_glw_high(size), 0, 0};
+	bu_glw_tracer.record(BU_GLW_TRACE_BUFFER_SUB_DATA, words, 8, 6, data, size);
+}
+
+/* Record the whole contents of the buffer bound to target, read back from the GPU. For writes that went through a mapping,
+ * which can only be seen once it is unmapped. */
+static void bu_glw_trace_buffer_contents(GLenum target, GLuint buffer, GLsizeiptr size){
+	if(!bu_glw_tracer.enabled() || size <= 0)
+		return;
+	void* contents = malloc(size);
+	if(contents == NULL)
+		throw( BuGlwMemoryError() );
+	glGetBufferSubData(target, 0, size, contents);
+	bu_glw_trace_buffer_sub_data(target, buffer, 0, size, contents);
+	free(contents);
+}
+
+/* The strings are joined into one payload. lengths may be NULL or hold negative values for null terminated strings, as with glShaderSource. */
+static std::string bu_glw_trace_source(GLsizei count, const GLchar* const* strings, const GLint* lengths){
+	std::string source;
+	for(GLsizei i = 0; i < count; ++i){
+		if(lengths != NULL && lengths[i] >= 0)
+			source.append(strings[i], lengths[i]);
+		else
+			source.append(strings[i]);
+	}
+	return source;
+}
+
+static inline void bu_glw_trace_shader_source(GLuint shader, GLenum type, GLsizei count, const GLchar* const* strings, const GLint* lengths){
+	if(!bu_glw_tracer.enabled())
+		return;
+	std::string source = bu_glw_trace_source(count, strings, lengths);
+	uint32_t words[4] = {shader, type, 0, 0};
+	bu_glw_tracer.record(BU_GLW_TRACE_SHADER_SOURCE, words, 4, 2, source.c_str(), source.size() + 1);
+}
+
+static inline void bu_glw_trace_stage_program(GLuint program, GLenum type, GLsizei count, const GLchar* const* strings){
+	if(!bu_glw_tracer.enabled())
+		return;
+	std::string source = bu_glw_trace_source(count, strings, NULL);
+	uint32_t words[4] = {program, type, 0, 0};
+	bu_glw_tracer.record(BU_GLW_TRACE_STAGE_PROGRAM, words, 4, 2, source.c_str(), source.size() + 1);
+}
+
+static inline void bu_glw_trace_uniform_location(GLuint program, GLint location, const char* name){
+	if(!bu_glw_tracer.enabled())
+		return;
+	uint32_t words[4] = {program, (uint32_t)location, 0, 0};
+	bu_glw_tracer.record(BU_GLW_TRACE_UNIFORM_LOCATION, words, 4, 2, name, strlen(name) + 1);
+}
+
+static inline uint32_t bu_glw_trace_word(GLfloat value){
+	uint32_t word;
+	memcpy(&word, &value, sizeof(word));
+	return word;
+}
+static inline uint32_t bu_glw_trace_word(GLint value){ return (uint32_t)value; }
+static inline uint32_t bu_glw_trace_word(GLuint value){ return value; }
+static inline uint32_t bu_glw_trace_uniform_type(GLfloat){ return BU_GLW_TRACE_UNIFORM_FLOAT; }
+static inline uint32_t bu_glw_trace_uniform_type(GLint){ return BU_GLW_TRACE_UNIFORM_INT; }
+static inline uint32_t bu_glw_trace_uniform_type(GLuint){ return BU_GLW_TRACE_UNIFORM_UINT; }
+
+/* separable: set with glProgramUniform* instead of glUniform* on the program in use. */
+template<typename T, typename... Rest>
+static inline void bu_glw_trace_uniform(GLuint program, GLint location, bool separable, T v0, Rest... rest){
+	if(!bu_glw_tracer.enabled())
+		return;
+	uint32_t values[4] = {bu_glw_trace_word(v0), bu_glw_trace_word(rest)...};
+	bu_glw_trace(BU_GLW_TRACE_UNIFORM, program, location, bu_glw_trace_uniform_type(v0), 1 + sizeof...(Rest), separable,
+		values[0], values[1], values[2], values[3]);
+}
+
+/* One create record per name. */
+static inline void bu_glw_trace_created(TraceOpcode opcode, GLsizei count, const GLuint* names){
+	if(!bu_glw_tracer.enabled())
+		return;
+	for(GLsizei i = 0; i < count; ++i)
+		bu_glw_tracer.record(opcode, &names[i], 1);
+}
+
+void bu_glw_trace_begin(const char* path){
+	bu_glw_tracer.begin(path);
+}
+
+void bu_glw_trace_frame(){
+	bu_glw_tracer.frame();
+}
+
+void bu_glw_trace_end(){
+	bu_glw_tracer.end();
+}
+
+bool bu_glw_tracing(){
+	return bu_glw_tracer.enabled();
+}
+
+#else
+
+/* Compiled out, these vanish. */
+template<typename... Words>
+static inline void bu_glw_trace(TraceOpcode, Words...){}
+static inline void bu_glw_trace_buffer_data(GLenum, GLuint, GLenum, GLsizeiptr, const void*){}
+static inline void bu_glw_trace_buffer_sub_data(GLenum, GLuint, GLintptr, GLsizeiptr, const void*){}
+static inline void bu_glw_trace_buffer_contents(GLenum, GLuint, GLsizeiptr){}
+static inline void bu_glw_trace_shader_source(GLuint, GLenum, GLsizei, const GLchar* const*, const GLint*){}
+static inline void bu_glw_trace_stage_program(GLuint, GLenum, GLsizei, const GLchar* const*){}
+static inline void bu_glw_trace_uniform_location(GLuint, GLint, const char*){}
+template<typename T, typename... Rest>
+static inline void bu_glw_trace_uniform(GLuint, GLint, bool, T, Rest...){}
+static inline void bu_glw_trace_created(TraceOpcode, GLsizei, const GLuint*){}
+
+void bu_glw_trace_begin(const char* path){
+	fprintf(stderr, "bu_glw was built without BU_GLW_TRACE, %s will not be written.\n", path);
+}
+
+void bu_glw_trace_frame(){
+}
+
+void bu_glw_trace_end(){
+}
+
+bool bu_glw_tracing(){
+	return false;
+}
+
+#endif
+
+/************************** Drawing *************************/
+
+void bu_glw_draw_arrays(GLenum mode, GLint first, GLsizei count){
+	glDrawArrays(mode, first, count);
+	bu_glw_trace(BU_GLW_TRACE_DRAW_ARRAYS, mode, first, count);
+}
+
+void bu_glw_draw_elements(GLenum mode, GLsizei count, GLenum type, GLintptr offset){
+	glDrawElements(mode, count, type, (void*)offset);
+	bu_glw_trace(BU_GLW_TRACE_DRAW_ELEMENTS, mode, count, type, bu_glw_low(offset), bu_glw_high(offset));
+}
+
 /************************** Shaders *************************/
 
 Shader::Shader(const char* path, GLenum type) : 
 	m_code{nullptr},
+	m_ID{0},
 	m_shader_type{type}
 {
 	if(path==nullptr){
@@ -27,17 +262,34 @@ Shader::Shader(const char* path, GLenum type) :
 	}
 	m_code = bu_glw_read_file_into_string(path);
 };
+
+Shader::Shader(Shader&& other) noexcept :
+	m_code{other.m_code},
+	m_ID{other.m_ID},
+	m_shader_type{other.m_shader_type}
+{
+	other.m_code = nullptr;
+	other.m_ID = 0;
+}
+
 Shader::~Shader(){
 	free(m_code);
 	glDeleteShader(m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_SHADER, m_ID);
 }
 
 void Shader::compile(){
-	m_ID = glCreateShader(m_shader_type);
-	glShaderSource(m_ID, 1, &m_code, NULL);
+	compile(1, &m_code, NULL);
 	free(m_code);
 	m_code = NULL;
+}
+
+void Shader::compile(GLsizei count, const GLchar* const* strings, const GLint* lengths){
+	m_ID = glCreateShader(m_shader_type);
+	glShaderSource(m_ID, count, strings, lengths);
 	glCompileShader(m_ID);
+	bu_glw_trace_shader_source(m_ID, m_shader_type, count, strings, lengths);
 	int  success;
 	char message[512];
 	glGetShaderiv(m_ID, GL_COMPILE_STATUS, &success);
@@ -49,9 +301,46 @@ void Shader::compile(){
 	}
 }
 
+void Shader::compile(const EmbeddedShader& source){
+#if BU_GLW_SHADERS_FROM_DISK
+	try{
+		m_code = bu_glw_read_file_into_string(source.path);
+		compile();
+		return;
+	}catch(BuGlwBadFilePath&){
+		fprintf(stderr, "Could not read %s, using the embedded copy instead.\n", source.path);
+	}catch(BuGlwIOError&){
+		fprintf(stderr, "Could not read %s, using the embedded copy instead.\n", source.path);
+	}
+#endif
+	const GLchar* code = source.source();
+	compile(1, &code, &source.length);
+}
+
 
 void Shader::attachTo(const GLuint prog){
 	glAttachShader(prog, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_ATTACH_SHADER, prog, m_ID);
+}
+
+/* Link the program. If that fails it is deleted before throwing, as the constructor which created it does not finish.
+ * Separable programs can be used for some of their stages in a ProgramPipeline, which has to be decided before linking. */
+static void bu_glw_link_program(GLuint program, bool separable = false){
+	if(separable)
+		glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	glLinkProgram(program);
+	bu_glw_trace(BU_GLW_TRACE_LINK_PROGRAM, program, separable);
+	int  success = 0;
+	char message[512] = {0};
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if(!success)
+	{
+		glGetProgramInfoLog(program, 512, NULL, message);
+		fprintf(stderr, "Error during shader linking: %s\n", message);
+		glDeleteProgram(program);
+		bu_glw_trace(BU_GLW_TRACE_DELETE_PROGRAM, program);
+		throw( GLShaderProgramLinkingFailed() );
+	}
 }
 
 void setUniform(const char* name, GLfloat v0, GLfloat v1);
@@ -59,87 +348,124 @@ void setUniform(const char* name, GLfloat v0, GLfloat v1, GLfloat v2);
 void setUniform(const char* name, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
 
 
-ShaderProgram::ShaderProgram(VertexShader& vs, FragmentShader& fs) :
-	m_gs{nullptr},
-	m_vs{std::move(vs)},
+ShaderProgram::ShaderProgram(VertexShader& vs, FragmentShader& fs, bool separable) :
 	m_fs{std::move(fs)},
-	m_uniform_list_length{0},
-	m_uniform_list_size{0},
+	m_vs{std::move(vs)},
+	m_gs{nullptr},
+	m_ID{glCreateProgram()},
 	m_uniforms{nullptr},
-	m_ID{glCreateProgram()}
+	m_uniform_list_size{0},
+	m_uniform_list_length{0}
 {
-	vs.attachTo(m_ID);
-	fs.attachTo(m_ID);
-	glLinkProgram(m_ID);
-	int  success = 0;
-	char message[512] = {0};
-	glGetProgramiv(m_ID, GL_COMPILE_STATUS, &success);
-	if(!success)
-	{
-		glGetShaderInfoLog(m_ID, 512, NULL, message);
-		fprintf(stderr, "Error during shader linking: %s\n", message);
-		throw( GLShaderProgramLinkingFailed() );
-	}
+	/* vs and fs have been moved from, their shader objects are owned by m_vs and m_fs now. */
+	m_vs.attachTo(m_ID);
+	m_fs.attachTo(m_ID);
+	bu_glw_link_program(m_ID, separable);
 }
 
-ShaderProgram::ShaderProgram(const char* vs_path, const char* fs_path) : 
+/* The program is only created once the shaders compiled, a throwing compile() would leak it otherwise. */
+ShaderProgram::ShaderProgram(const char* vs_path, const char* fs_path, bool separable) : 
+	m_fs{fs_path},
 	m_vs{vs_path},
 	m_gs{nullptr},
-	m_fs{fs_path},
-	m_uniform_list_length{0},
-	m_uniform_list_size{0},
+	m_ID{0},
 	m_uniforms{nullptr},
-	m_ID{glCreateProgram()}
+	m_uniform_list_size{0},
+	m_uniform_list_length{0}
 {
 	m_vs.compile();
 	m_fs.compile();
 	
+	m_ID = glCreateProgram();
 	m_vs.attachTo(m_ID);
 	m_fs.attachTo(m_ID);
-	glLinkProgram(m_ID);
-	int  success = 0;
-	char message[512] = {0};
-	glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
-	if(!success)
-	{
-		glGetShaderInfoLog(m_ID, 512, NULL, message);
-		fprintf(stderr, "Error during shader linking: %s\n", message);
-		throw( GLShaderProgramLinkingFailed() );
-	}
+	bu_glw_link_program(m_ID, separable);
 }
 
-ShaderProgram::ShaderProgram(const char* vs, const char* gs, const char* fs) :
+ShaderProgram::ShaderProgram(const char* vs, const char* gs, const char* fs, bool separable) :
+	m_fs{fs},
 	m_vs{vs},
 	m_gs{gs},
-	m_fs{fs},
-	m_uniform_list_length{0},
-	m_uniform_list_size{0},
+	m_ID{0},
 	m_uniforms{nullptr},
-	m_ID{glCreateProgram()}
+	m_uniform_list_size{0},
+	m_uniform_list_length{0}
 {
 	m_vs.compile();
 	m_fs.compile();
 	m_gs.compile();
 	
+	m_ID = glCreateProgram();
 	m_vs.attachTo(m_ID);
 	m_fs.attachTo(m_ID);
 	m_gs.attachTo(m_ID);
-	glLinkProgram(m_ID);
-	int  success = 0;
-	char message[512] = {0};
-	glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
-	if(!success)
-	{
-		glGetShaderInfoLog(m_ID, 512, NULL, message);
-		fprintf(stderr, "Error during shader linking: %s\n", message);
-		throw( GLShaderProgramLinkingFailed() );
-	}
+	bu_glw_link_program(m_ID, separable);
 }
 
+ShaderProgram::ShaderProgram(const EmbeddedShader& vs, const EmbeddedShader& fs, bool separable) :
+	m_fs{nullptr},
+	m_vs{nullptr},
+	m_gs{nullptr},
+	m_ID{0},
+	m_uniforms{nullptr},
+	m_uniform_list_size{0},
+	m_uniform_list_length{0}
+{
+	m_vs.compile(vs);
+	m_fs.compile(fs);
+
+	m_ID = glCreateProgram();
+	m_vs.attachTo(m_ID);
+	m_fs.attachTo(m_ID);
+	bu_glw_link_program(m_ID, separable);
+}
 
+ShaderProgram::ShaderProgram(const EmbeddedShader& vs, const EmbeddedShader& gs, const EmbeddedShader& fs, bool separable) :
+	m_fs{nullptr},
+	m_vs{nullptr},
+	m_gs{nullptr},
+	m_ID{0},
+	m_uniforms{nullptr},
+	m_uniform_list_size{0},
+	m_uniform_list_length{0}
+{
+	m_vs.compile(vs);
+	m_gs.compile(gs);
+	m_fs.compile(fs);
+
+	m_ID = glCreateProgram();
+	m_vs.attachTo(m_ID);
+	m_gs.attachTo(m_ID);
+	m_fs.attachTo(m_ID);
+	bu_glw_link_program(m_ID, separable);
+}
+
+
+ShaderProgram::ShaderProgram(ShaderProgram&& other) noexcept :
+	m_fs{std::move(other.m_fs)},
+	m_vs{std::move(other.m_vs)},
+	m_gs{std::move(other.m_gs)},
+	m_ID{other.m_ID},
+	m_uniforms{other.m_uniforms},
+	m_uniform_list_size{other.m_uniform_list_size},
+	m_uniform_list_length{other.m_uniform_list_length}
+{
+	other.m_ID = 0;
+	other.m_uniforms = nullptr;
+	other.m_uniform_list_size = 0;
+	other.m_uniform_list_length = 0;
+}
+
+ShaderProgram::~ShaderProgram(){
+	free(m_uniforms);
+	glDeleteProgram(m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_PROGRAM, m_ID);
+}
 
 void ShaderProgram::use(){
 	glUseProgram(m_ID);
+	bu_glw_trace(BU_GLW_TRACE_USE_PROGRAM, m_ID);
 }
 
 unsigned int ShaderProgram::registerUniform(const char* name){
@@ -152,6 +478,7 @@ unsigned int ShaderProgram::registerUniform(const char* name){
 		strncpy(&new_uniform->name[0], name, BU_GLW_MAX_UNIFORM_NAME_LENGTH);
 		new_uniform->name[BU_GLW_MAX_UNIFORM_NAME_LENGTH] = '\0';
 		new_uniform->ID = location;
+		bu_glw_trace_uniform_location(m_ID, location, name);
 		m_uniform_list_length++;
 	}else{
 		/* If not enough memory is available we shall allocate it.*/
@@ -166,6 +493,7 @@ unsigned int ShaderProgram::registerUniform(const char* name){
 				strncpy( &new_uniform->name[0], name, BU_GLW_MAX_UNIFORM_NAME_LENGTH);
 				new_uniform->name[BU_GLW_MAX_UNIFORM_NAME_LENGTH] = '\0';
 				new_uniform->ID = location;
+				bu_glw_trace_uniform_location(m_ID, location, name);
 				m_uniform_list_length++;
 				if(m_uniforms == nullptr)
 					throw(new BuGlwMemoryError);
@@ -213,42 +541,50 @@ void ShaderProgram::finishUniformRegistration(){
 void ShaderProgram::setUniform(unsigned int ID, GLfloat v0){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform1f(m_uniforms[ID].ID, v0);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0);
 
 }
 void ShaderProgram::setUniform(unsigned int ID, GLfloat v0, GLfloat v1){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform2f(m_uniforms[ID].ID, v0, v1);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1);
 
 }
 
 void ShaderProgram::setUniform(unsigned int ID, GLfloat v0, GLfloat v1, GLfloat v2){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform3f(m_uniforms[ID].ID, v0, v1, v2);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1, v2);
 
 }
 
 void ShaderProgram::setUniform(unsigned int ID, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform4f(m_uniforms[ID].ID, v0, v1, v2, v3);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1, v2, v3);
 }
 
 
 void ShaderProgram::setUniform(unsigned int ID, GLint v0){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform1i(m_uniforms[ID].ID, v0);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0);
 }
 void ShaderProgram::setUniform(unsigned int ID, GLint v0, GLint v1){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform2i(m_uniforms[ID].ID, v0, v1);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1);
 }
 void ShaderProgram::setUniform(unsigned int ID, GLint v0, GLint v1, GLint v2){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform3i(m_uniforms[ID].ID, v0, v1, v2);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1, v2);
 }
 
 void ShaderProgram::setUniform(unsigned int ID, GLint v0, GLint v1, GLint v2, GLint v3){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform4i(m_uniforms[ID].ID, v0, v1, v2, v3);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1, v2, v3);
 }
 
 
@@ -256,25 +592,378 @@ void ShaderProgram::setUniform(unsigned int ID, GLint v0, GLint v1, GLint v2, GL
 void ShaderProgram::setUniform(unsigned int ID, GLuint v0){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform1ui(m_uniforms[ID].ID, v0);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0);
 }
 
 void ShaderProgram::setUniform(unsigned int ID, GLuint v0, GLuint v1){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform2ui(m_uniforms[ID].ID, v0, v1);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1);
 }
 
 void ShaderProgram::setUniform(unsigned int ID, GLuint v0, GLuint v1, GLuint v2){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform3ui(m_uniforms[ID].ID, v0, v1, v2);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1, v2);
 }
 
 void ShaderProgram::setUniform(unsigned int ID, GLuint v0, GLuint v1, GLuint v2, GLuint v3){
 	BU_GLW_LOCAL_BOUNDS_CHECK
 	glUniform4ui(m_uniforms[ID].ID, v0, v1, v2, v3);
+	bu_glw_trace_uniform(m_ID, m_uniforms[ID].ID, false, v0, v1, v2, v3);
 }
 
 #undef BU_GLW_LOCAL_BOUNDS_CHECK
 
+/********************** Separable programs ******************/
+
+/* glCreateShaderProgramv compiles and links in one go, a failed compilation shows up as a failed link. */
+static GLuint bu_glw_create_stage_program(GLenum type, GLsizei count, const GLchar* const* strings){
+	GLuint program = glCreateShaderProgramv(type, count, strings);
+	if(program == 0)
+		throw( GLShaderCompilationFailed() );
+	int  success = 0;
+	char message[512] = {0};
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if(!success)
+	{
+		glGetProgramInfoLog(program, 512, NULL, message);
+		fprintf(stderr, "Error during shader compilation: %s\n", message);
+		glDeleteProgram(program);
+		throw( GLShaderCompilationFailed() );
+	}
+	bu_glw_trace_stage_program(program, type, count, strings);
+	return program;
+}
+
+static GLbitfield bu_glw_stage_bit(GLenum type){
+	switch(type){
+		case GL_VERTEX_SHADER:          return GL_VERTEX_SHADER_BIT;
+		case GL_TESS_CONTROL_SHADER:    return GL_TESS_CONTROL_SHADER_BIT;
+		case GL_TESS_EVALUATION_SHADER: return GL_TESS_EVALUATION_SHADER_BIT;
+		case GL_GEOMETRY_SHADER:        return GL_GEOMETRY_SHADER_BIT;
+		case GL_FRAGMENT_SHADER:        return GL_FRAGMENT_SHADER_BIT;
+		case GL_COMPUTE_SHADER:         return GL_COMPUTE_SHADER_BIT;
+	}
+	throw( BuGlwRealBad() );
+}
+
+StageProgram::StageProgram(const char* path, GLenum type) :
+	m_ID{0},
+	m_shader_type{type}
+{
+	char* code = bu_glw_read_file_into_string(path);
+	try{
+		m_ID = bu_glw_create_stage_program(type, 1, &code);
+	}catch(...){
+		free(code);
+		throw;
+	}
+	free(code);
+}
+
+StageProgram::StageProgram(GLenum type, GLsizei count, const GLchar* const* strings) :
+	m_ID{bu_glw_create_stage_program(type, count, strings)},
+	m_shader_type{type}
+{
+}
+
+StageProgram::StageProgram(StageProgram&& other) noexcept :
+	m_ID{other.m_ID},
+	m_shader_type{other.m_shader_type}
+{
+	other.m_ID = 0;
+}
+
+StageProgram::~StageProgram(){
+	glDeleteProgram(m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_PROGRAM, m_ID);
+}
+
+GLbitfield StageProgram::stageBit() const{
+	return bu_glw_stage_bit(m_shader_type);
+}
+
+GLint StageProgram::getUniformLocation(const char* name){
+	GLint location = glGetUniformLocation(m_ID, name);
+	if(location == -1)
+		throw(GLInexistentUniform());
+	bu_glw_trace_uniform_location(m_ID, location, name);
+	return location;
+}
+
+void StageProgram::setUniform(GLint location, GLfloat v0){
+	glProgramUniform1f(m_ID, location, v0);
+	bu_glw_trace_uniform(m_ID, location, true, v0);
+}
+
+void StageProgram::setUniform(GLint location, GLfloat v0, GLfloat v1){
+	glProgramUniform2f(m_ID, location, v0, v1);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1);
+}
+
+void StageProgram::setUniform(GLint location, GLfloat v0, GLfloat v1, GLfloat v2){
+	glProgramUniform3f(m_ID, location, v0, v1, v2);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1, v2);
+}
+
+void StageProgram::setUniform(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3){
+	glProgramUniform4f(m_ID, location, v0, v1, v2, v3);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1, v2, v3);
+}
+
+void StageProgram::setUniform(GLint location, GLint v0){
+	glProgramUniform1i(m_ID, location, v0);
+	bu_glw_trace_uniform(m_ID, location, true, v0);
+}
+
+void StageProgram::setUniform(GLint location, GLint v0, GLint v1){
+	glProgramUniform2i(m_ID, location, v0, v1);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1);
+}
+
+void StageProgram::setUniform(GLint location, GLint v0, GLint v1, GLint v2){
+	glProgramUniform3i(m_ID, location, v0, v1, v2);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1, v2);
+}
+
+void StageProgram::setUniform(GLint location, GLint v0, GLint v1, GLint v2, GLint v3){
+	glProgramUniform4i(m_ID, location, v0, v1, v2, v3);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1, v2, v3);
+}
+
+void StageProgram::setUniform(GLint location, GLuint v0){
+	glProgramUniform1ui(m_ID, location, v0);
+	bu_glw_trace_uniform(m_ID, location, true, v0);
+}
+
+void StageProgram::setUniform(GLint location, GLuint v0, GLuint v1){
+	glProgramUniform2ui(m_ID, location, v0, v1);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1);
+}
+
+void StageProgram::setUniform(GLint location, GLuint v0, GLuint v1, GLuint v2){
+	glProgramUniform3ui(m_ID, location, v0, v1, v2);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1, v2);
+}
+
+void StageProgram::setUniform(GLint location, GLuint v0, GLuint v1, GLuint v2, GLuint v3){
+	glProgramUniform4ui(m_ID, location, v0, v1, v2, v3);
+	bu_glw_trace_uniform(m_ID, location, true, v0, v1, v2, v3);
+}
+
+ProgramPipeline::ProgramPipeline() :
+	m_ID{666}
+{
+	glGenProgramPipelines(1, &m_ID);
+}
+
+ProgramPipeline::ProgramPipeline(const StageProgram& vs, const StageProgram& fs) :
+	ProgramPipeline()
+{
+	useStage(vs);
+	useStage(fs);
+}
+
+ProgramPipeline::ProgramPipeline(const StageProgram& vs, const StageProgram& gs, const StageProgram& fs) :
+	ProgramPipeline()
+{
+	useStage(vs);
+	useStage(gs);
+	useStage(fs);
+}
+
+ProgramPipeline::ProgramPipeline(ProgramPipeline&& other) noexcept :
+	m_ID{other.m_ID}
+{
+	other.m_ID = 0;
+}
+
+ProgramPipeline::~ProgramPipeline(){
+	glDeleteProgramPipelines(1, &m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_PIPELINE, m_ID);
+}
+
+void ProgramPipeline::useStage(const StageProgram& stage){
+	glUseProgramStages(m_ID, stage.stageBit(), stage.m_ID);
+	bu_glw_trace(BU_GLW_TRACE_PIPELINE_STAGES, m_ID, stage.stageBit(), stage.m_ID);
+}
+
+void ProgramPipeline::useStages(const ShaderProgram& program, GLbitfield stages){
+	glUseProgramStages(m_ID, stages, program.m_ID);
+	bu_glw_trace(BU_GLW_TRACE_PIPELINE_STAGES, m_ID, stages, program.m_ID);
+}
+
+void ProgramPipeline::clearStage(GLenum type){
+	glUseProgramStages(m_ID, bu_glw_stage_bit(type), 0);
+	bu_glw_trace(BU_GLW_TRACE_PIPELINE_STAGES, m_ID, bu_glw_stage_bit(type), 0);
+}
+
+GLuint ProgramPipeline::stageProgram(GLenum type) const{
+	GLint program = 0;
+	glGetProgramPipelineiv(m_ID, type, &program);
+	return (GLuint)program;
+}
+
+void ProgramPipeline::activateStage(GLenum type){
+	glActiveShaderProgram(m_ID, stageProgram(type));
+}
+
+void ProgramPipeline::bind(){
+	glUseProgram(0);
+	glBindProgramPipeline(m_ID);
+	bu_glw_trace(BU_GLW_TRACE_USE_PROGRAM, 0);
+	bu_glw_trace(BU_GLW_TRACE_BIND_PIPELINE, m_ID);
+}
+
+void ProgramPipeline::unbind(){
+	glBindProgramPipeline(0);
+	bu_glw_trace(BU_GLW_TRACE_BIND_PIPELINE, 0);
+}
+
+bool ProgramPipeline::validate(){
+	GLint success = 0;
+	char message[512] = {0};
+	glValidateProgramPipeline(m_ID);
+	glGetProgramPipelineiv(m_ID, GL_VALIDATE_STATUS, &success);
+	if(!success){
+		glGetProgramPipelineInfoLog(m_ID, 512, NULL, message);
+		fprintf(stderr, "Program pipeline validation failed: %s\n", message);
+		return false;
+	}
+	return true;
+}
+
+/*********************** Compute shaders ********************/
+
+ComputeProgram::ComputeProgram(ComputeShader& cs) :
+	m_cs{std::move(cs)},
+	m_ID{glCreateProgram()},
+	m_local_size{0, 0, 0}
+{
+	m_cs.attachTo(m_ID);
+	bu_glw_link_program(m_ID);
+	glGetProgramiv(m_ID, GL_COMPUTE_WORK_GROUP_SIZE, m_local_size);
+}
+
+/* As for ShaderProgram, the program is created once the shader compiled so a failed compile does not leak it. */
+ComputeProgram::ComputeProgram(const char* cs_path) :
+	m_cs{cs_path},
+	m_ID{0},
+	m_local_size{0, 0, 0}
+{
+	m_cs.compile();
+	m_ID = glCreateProgram();
+	m_cs.attachTo(m_ID);
+	bu_glw_link_program(m_ID);
+	glGetProgramiv(m_ID, GL_COMPUTE_WORK_GROUP_SIZE, m_local_size);
+}
+
+ComputeProgram::ComputeProgram(const EmbeddedShader& cs) :
+	m_cs{nullptr},
+	m_ID{0},
+	m_local_size{0, 0, 0}
+{
+	m_cs.compile(cs);
+	m_ID = glCreateProgram();
+	m_cs.attachTo(m_ID);
+	bu_glw_link_program(m_ID);
+	glGetProgramiv(m_ID, GL_COMPUTE_WORK_GROUP_SIZE, m_local_size);
+}
+
+
+ComputeProgram::ComputeProgram(ComputeProgram&& other) noexcept :
+	m_cs{std::move(other.m_cs)},
+	m_ID{other.m_ID},
+	m_local_size{other.m_local_size[0], other.m_local_size[1], other.m_local_size[2]}
+{
+	other.m_ID = 0;
+}
+
+ComputeProgram::~ComputeProgram(){
+	glDeleteProgram(m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_PROGRAM, m_ID);
+}
+
+void ComputeProgram::use(){
+	glUseProgram(m_ID);
+	bu_glw_trace(BU_GLW_TRACE_USE_PROGRAM, m_ID);
+}
+
+GLint ComputeProgram::getUniformLocation(const char* name){
+	GLint location = glGetUniformLocation(m_ID, name);
+	if(location == -1)
+		throw(GLInexistentUniform());
+	bu_glw_trace_uniform_location(m_ID, location, name);
+	return location;
+}
+
+void ComputeProgram::dispatch(GLuint x, GLuint y, GLuint z){
+	glUseProgram(m_ID);
+	glDispatchCompute(x, y, z);
+	bu_glw_trace(BU_GLW_TRACE_DISPATCH, m_ID, x, y, z);
+}
+
+void ComputeProgram::dispatchInvocations(GLuint x, GLuint y, GLuint z){
+	/* Round up, the shader is expected to discard the invocations past the end itself.
+	 * Written without adding to the count first, which would overflow for counts near the GLuint maximum. */
+	GLuint sx = (GLuint)m_local_size[0], sy = (GLuint)m_local_size[1], sz = (GLuint)m_local_size[2];
+	dispatch(
+		x / sx + (x % sx != 0),
+		y / sy + (y % sy != 0),
+		z / sz + (z % sz != 0)
+	);
+}
+
+void ComputeProgram::dispatchIndirect(GLintptr offset){
+	glUseProgram(m_ID);
+	glDispatchComputeIndirect(offset);
+	bu_glw_trace(BU_GLW_TRACE_DISPATCH_INDIRECT, m_ID, bu_glw_low(offset), bu_glw_high(offset));
+}
+
+void ComputeProgram::dispatchIndirect(const SSBO& buffer, GLintptr offset){
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer.id());
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_DISPATCH_INDIRECT_BUFFER, buffer.id());
+	dispatchIndirect(offset);
+}
+
+void bu_glw_memory_barrier(GLbitfield barriers){
+	glMemoryBarrier(barriers);
+	bu_glw_trace(BU_GLW_TRACE_MEMORY_BARRIER, barriers);
+}
+
+void bu_glw_storage_barrier(){
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	bu_glw_trace(BU_GLW_TRACE_MEMORY_BARRIER, GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void bu_glw_image_barrier(){
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	bu_glw_trace(BU_GLW_TRACE_MEMORY_BARRIER, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void bu_glw_vertex_barrier(){
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+	bu_glw_trace(BU_GLW_TRACE_MEMORY_BARRIER, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+}
+
+void bu_glw_command_barrier(){
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	bu_glw_trace(BU_GLW_TRACE_MEMORY_BARRIER, GL_COMMAND_BARRIER_BIT);
+}
+
+/* Not traced, see the header. */
+void bu_glw_bind_image(GLuint unit, GLuint texture, GLenum access, GLenum format, GLint level){
+	glBindImageTexture(unit, texture, level, GL_FALSE, 0, access, format);
+}
+
+void bu_glw_bind_image_layered(GLuint unit, GLuint texture, GLenum access, GLenum format, GLint level){
+	glBindImageTexture(unit, texture, level, GL_TRUE, 0, access, format);
+}
+
 
 char* bu_glw_read_file_into_string(const char* path){
 #if __linux__
@@ -364,54 +1053,180 @@ fclose(file);
 return string;
 }
 
+MappedFile::MappedFile(const char* path) :
+	m_data{nullptr},
+	m_size{0}
+{
+#if __linux__
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+		throw( BuGlwBadFilePath() );
+	struct stat file_info;
+	if( fstat(fd, &file_info) != 0 ){
+		close(fd);
+		throw( BuGlwIOError() );
+	}
+	m_size = file_info.st_size;
+	if(m_size == 0){
+		close(fd);
+		return;
+	}
+	void* mapped_file = mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); /* The mapping keeps the file alive. */
+	if( mapped_file == MAP_FAILED )
+		throw( BuGlwIOError() );
+	/* Start reading ahead, the whole file is going to be needed. */
+	madvise(mapped_file, m_size, MADV_WILLNEED);
+	m_data = (const unsigned char*)mapped_file;
+#else
+	FILE* file = fopen(path, "rb");
+	if(file == NULL)
+		throw( BuGlwBadFilePath() );
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if(size < 0){
+		fclose(file);
+		throw( BuGlwIOError() );
+	}
+	m_size = (size_t)size;
+	unsigned char* buffer = (unsigned char*)malloc(m_size > 0 ? m_size : 1);
+	if(buffer == NULL){
+		fclose(file);
+		throw( BuGlwMemoryError() );
+	}
+	if(fread(buffer, 1, m_size, file) != m_size){
+		free(buffer);
+		fclose(file);
+		throw( BuGlwIOError() );
+	}
+	fclose(file);
+	m_data = buffer;
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+	m_data{other.m_data},
+	m_size{other.m_size}
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+}
+
+MappedFile::~MappedFile(){
+#if __linux__
+	if(m_data != nullptr)
+		munmap((void*)m_data, m_size);
+#else
+	free((void*)m_data);
+#endif
+}
+
 /******************************** VBO *************************************/
 VBO::VBO() : 
 	m_ID{666}, /* An evil default number. It should be replaced either way, but if it isn't it should at least cause a nice crash and be visible in the debugger. */
+	m_draw_mode{GL_STATIC_DRAW},
 	m_length{0},
-	m_draw_mode{GL_STATIC_DRAW}
+	m_size{0}
 {
-	glGenBuffers(1, &m_ID);
+	bu_glw_gen_buffers(1, &m_ID);
 #if BU_GLW_CONSTRUCTORS_BIND==1 
 	glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ARRAY_BUFFER, m_ID);
 #endif
 }
 
 VBO::VBO(const float* array, GLuint length, GLenum draw_mode) : 
+	m_draw_mode{draw_mode},
 	m_length{length},
-	m_draw_mode{draw_mode}
+	m_size{0}
 {
-	glGenBuffers(1, &m_ID);
+	bu_glw_gen_buffers(1, &m_ID);
 	glBindBuffer(GL_ARRAY_BUFFER, m_ID);
 	glBufferData(GL_ARRAY_BUFFER, length*sizeof(float), array, draw_mode);
+	bu_glw_trace_buffer_data(GL_ARRAY_BUFFER, m_ID, draw_mode, length*sizeof(float), array);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_VERTEX_BUFFERS, m_size, length*sizeof(float));
 }
 
 VBO::~VBO(){
+	bu_glw_buffer_resized(BU_GLW_MEMORY_VERTEX_BUFFERS, m_size, 0);
 	glDeleteBuffers(1, &m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_BUFFER, m_ID);
 }
 
-void VBO::data(float* data, GLuint length){
+VBO::VBO(VBO&& other) noexcept :
+	m_ID{other.m_ID},
+	m_draw_mode{other.m_draw_mode},
+	m_length{other.m_length},
+	m_size{other.m_size}
+{
+	other.m_ID = 0;
+	other.m_length = 0;
+	other.m_size = 0;
+}
+
+VBO& VBO::operator=(VBO&& other) noexcept{
+	if(this != &other){
+		bu_glw_buffer_resized(BU_GLW_MEMORY_VERTEX_BUFFERS, m_size, 0);
+		glDeleteBuffers(1, &m_ID);
+		if(m_ID != 0)
+			bu_glw_trace(BU_GLW_TRACE_DELETE_BUFFER, m_ID);
+		m_ID = other.m_ID;
+		m_draw_mode = other.m_draw_mode;
+		m_length = other.m_length;
+		m_size = other.m_size;
+		other.m_ID = 0;
+		other.m_length = 0;
+		other.m_size = 0;
+	}
+	return *this;
+}
+
+VBO VBO::adopt(GLuint id, GLenum draw_mode){
+	return VBO(id, draw_mode, 0);
+}
+
+void VBO::data(const float* data, GLuint length){
+	m_length = length;
 	glBindBuffer(GL_ARRAY_BUFFER, m_ID);
 	glBufferData(GL_ARRAY_BUFFER, length*sizeof(float), data, m_draw_mode);
+	bu_glw_trace_buffer_data(GL_ARRAY_BUFFER, m_ID, m_draw_mode, length*sizeof(float), data);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_VERTEX_BUFFERS, m_size, length*sizeof(float));
+}
+
+void VBO::raw_data(const void* data, GLsizeiptr size){
+	m_length = (unsigned int)(size / sizeof(float));
+	glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+	glBufferData(GL_ARRAY_BUFFER, size, data, m_draw_mode);
+	bu_glw_trace_buffer_data(GL_ARRAY_BUFFER, m_ID, m_draw_mode, size, data);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_VERTEX_BUFFERS, m_size, size);
 }
 
-void VBO::partial_data(GLintptr index, float* data, GLuint length){
+void VBO::partial_data(GLintptr index, const float* data, GLuint length){
 	glBindBuffer(GL_ARRAY_BUFFER, m_ID);
 	glBufferSubData(GL_ARRAY_BUFFER, index, length*sizeof(float), data);
+	bu_glw_trace_buffer_sub_data(GL_ARRAY_BUFFER, m_ID, index, length*sizeof(float), data);
 }
 
 void VBO::bind() const{
 	glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ARRAY_BUFFER, m_ID);
 }
 
 void VBO::unbind() const{
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ARRAY_BUFFER, 0);
 }
 
 void VBO::map(void (*f)(void*), GLenum mode) const{
 	glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ARRAY_BUFFER, m_ID);
 	void* ptr = glMapBuffer(GL_ARRAY_BUFFER, mode);
 	f(ptr);
 	glUnmapBuffer(GL_ARRAY_BUFFER);
+	if(mode != GL_READ_ONLY) /* It may have been written to. */
+		bu_glw_trace_buffer_contents(GL_ARRAY_BUFFER, m_ID, m_size);
 }
 
 void VBO::map(void (*f)(void*)) const {
@@ -427,55 +1242,132 @@ VAO::VAO() :
 	m_num_allocated_attributes{0},
 	m_stride{0}
 {
-	glGenVertexArrays(1, &m_ID);
+	bu_glw_gen_vertex_arrays(1, &m_ID);
 #if BU_GLW_CONSTRUCTORS_BIND==1 
 	glBindVertexArray(m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_VERTEX_ARRAY, m_ID);
 #endif
 }
 
 VAO::~VAO(){
 	free(m_attributes);
 	glDeleteVertexArrays(1, &m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_VERTEX_ARRAY, m_ID);
+}
+
+VAO::VAO(VAO&& other) noexcept :
+	m_ID{other.m_ID},
+	m_attributes{other.m_attributes},
+	m_num_attributes{other.m_num_attributes},
+	m_num_allocated_attributes{other.m_num_allocated_attributes},
+	m_stride{other.m_stride}
+{
+	other.m_ID = 0;
+	other.m_attributes = nullptr;
+	other.m_num_attributes = 0;
+	other.m_num_allocated_attributes = 0;
+	other.m_stride = 0;
+}
+
+VAO& VAO::operator=(VAO&& other) noexcept{
+	if(this != &other){
+		free(m_attributes);
+		glDeleteVertexArrays(1, &m_ID);
+		if(m_ID != 0)
+			bu_glw_trace(BU_GLW_TRACE_DELETE_VERTEX_ARRAY, m_ID);
+		m_ID = other.m_ID;
+		m_attributes = other.m_attributes;
+		m_num_attributes = other.m_num_attributes;
+		m_num_allocated_attributes = other.m_num_allocated_attributes;
+		m_stride = other.m_stride;
+		other.m_ID = 0;
+		other.m_attributes = nullptr;
+		other.m_num_attributes = 0;
+		other.m_num_allocated_attributes = 0;
+		other.m_stride = 0;
+	}
+	return *this;
+}
+
+VAO VAO::adopt(GLuint id){
+	return VAO(id);
 }
 
 
 void VAO::bind(){
 	glBindVertexArray(m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_VERTEX_ARRAY, m_ID);
 }
 
 void VAO::unbind(){
 	glBindVertexArray(0);
+	bu_glw_trace(BU_GLW_TRACE_BIND_VERTEX_ARRAY, 0);
 }
 
+void bu_glw_bind_vertex_array(GLuint id){
+	glBindVertexArray(id);
+	bu_glw_trace(BU_GLW_TRACE_BIND_VERTEX_ARRAY, id);
+}
+
+void bu_glw_bind_buffer(GLenum target, GLuint id){
+	glBindBuffer(target, id);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, target, id);
+}
+
+void bu_glw_gen_buffers(GLsizei count, GLuint* names){
+	glGenBuffers(count, names);
+	bu_glw_trace_created(BU_GLW_TRACE_CREATE_BUFFER, count, names);
+}
+
+void bu_glw_gen_vertex_arrays(GLsizei count, GLuint* names){
+	glGenVertexArrays(count, names);
+	bu_glw_trace_created(BU_GLW_TRACE_CREATE_VERTEX_ARRAY, count, names);
+}
+
+#if BU_GLW_GL_VERSION_AT_LEAST(4, 5)
+void bu_glw_create_buffers(GLsizei count, GLuint* names){
+	glCreateBuffers(count, names);
+	bu_glw_trace_created(BU_GLW_TRACE_CREATE_BUFFER, count, names);
+}
+
+void bu_glw_create_vertex_arrays(GLsizei count, GLuint* names){
+	glCreateVertexArrays(count, names);
+	bu_glw_trace_created(BU_GLW_TRACE_CREATE_VERTEX_ARRAY, count, names);
+}
+#endif
+
 
 void VAO::add_attribute(VertexAttrib atr){
 	/* No reallocation or initialization needed. Should be the most frequent case.*/
-	if(m_num_attributes <= m_num_allocated_attributes && m_num_attributes != 0){
-		m_attributes[m_num_allocated_attributes] = atr;
+	if(m_num_attributes < m_num_allocated_attributes){
+		m_attributes[m_num_attributes] = atr;
 		m_num_attributes++;
 		m_stride += atr.field_size * atr.num_fields;
 		return;
 	}
 	
 	/* The container should grow. A rarer case.*/
-	if(m_num_attributes > m_num_allocated_attributes){
-		m_attributes = (VertexAttrib*)realloc(m_attributes, 2*m_num_allocated_attributes);
+	if(m_attributes != nullptr){
+		VertexAttrib* ptr = (VertexAttrib*)realloc(m_attributes, 2*m_num_allocated_attributes*sizeof(VertexAttrib));
+		if(ptr == nullptr)
+			throw(BuGlwMemoryError());
+		m_attributes = ptr;
 		m_num_allocated_attributes *= 2;
+		m_attributes[m_num_attributes] = atr;
 		m_num_attributes++;
 		m_stride += atr.field_size * atr.num_fields;
 		return;
 	}
 
 	/* Initialization. Should be the rarest. It should happen only on object creation.*/
-	if(m_attributes == nullptr){
-		m_attributes = (VertexAttrib*)malloc( sizeof(VertexAttrib) * 2) /* Magic number */;
-		m_num_allocated_attributes = 2;
-		m_num_attributes = 1;
-		m_attributes[0] = atr;
-		m_stride += atr.field_size * atr.num_fields;
-		return;
-	}
-
+	m_attributes = (VertexAttrib*)malloc( sizeof(VertexAttrib) * 2) /* Magic number */;
+	if(m_attributes == nullptr)
+		throw(BuGlwMemoryError());
+	m_num_allocated_attributes = 2;
+	m_num_attributes = 1;
+	m_attributes[0] = atr;
+	m_stride += atr.field_size * atr.num_fields;
 }
 
 void VAO::add_attribute(uint num_fields, GLenum field_type, size_t field_size, GLboolean normalized){ /* Add an attribute cpu-side */ 
@@ -484,17 +1376,19 @@ void VAO::add_attribute(uint num_fields, GLenum field_type, size_t field_size, G
 
 void VAO::bind_attributes_no_discard(){
 	size_t offset = 0;
-	for(int i = 0; i < m_num_attributes; ++i){
+	for(unsigned int i = 0; i < m_num_attributes; ++i){
 		glVertexAttribPointer(
 				i,
 				m_attributes[i].num_fields,
 				m_attributes[i].field_type,
-				m_attributes->normalized,
+				m_attributes[i].normalized,
 				m_stride,
 				(void*)(offset)
 			);
-		offset += m_attributes[i].field_size*m_attributes[i].num_fields;
 		glEnableVertexAttribArray(i);
+		bu_glw_trace(BU_GLW_TRACE_VERTEX_ATTRIB, i, m_attributes[i].num_fields, m_attributes[i].field_type, m_attributes[i].normalized,
+			m_stride, bu_glw_low(offset), bu_glw_high(offset));
+		offset += m_attributes[i].field_size*m_attributes[i].num_fields;
 	}
 }
 
@@ -502,55 +1396,224 @@ void VAO::bind_attributes(){
 	bind_attributes_no_discard();
 	free(m_attributes);
 	m_attributes = nullptr;
+	m_num_attributes = 0;
+	m_num_allocated_attributes = 0;
+	m_stride = 0;
 }
 
 /************************* EBO ******************************/
 
 EBO::EBO() : 
 	m_ID{666}, /* An evil default number. It should be replaced either way, but if it isn't it should at least cause a nice crash and be visible in the debugger. */
+	m_draw_mode{GL_STATIC_DRAW},
 	m_length{0},
-	m_draw_mode{GL_STATIC_DRAW}
+	m_size{0}
 {
-	glGenBuffers(1, &m_ID);
+	bu_glw_gen_buffers(1, &m_ID);
 #if BU_GLW_CONSTRUCTORS_BIND==1 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ELEMENT_ARRAY_BUFFER, m_ID);
 #endif
 }
 
 EBO::EBO(const unsigned int* array, GLuint length, GLenum draw_mode) : 
+	m_draw_mode{draw_mode},
 	m_length{length},
-	m_draw_mode{draw_mode}
+	m_size{0}
 {
-	glGenBuffers(1, &m_ID);
+	bu_glw_gen_buffers(1, &m_ID);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, length*sizeof(unsigned int), array, draw_mode);
+	bu_glw_trace_buffer_data(GL_ELEMENT_ARRAY_BUFFER, m_ID, draw_mode, length*sizeof(unsigned int), array);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_INDEX_BUFFERS, m_size, length*sizeof(unsigned int));
 }
 
 EBO::~EBO(){
+	bu_glw_buffer_resized(BU_GLW_MEMORY_INDEX_BUFFERS, m_size, 0);
 	glDeleteBuffers(1, &m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_BUFFER, m_ID);
+}
+
+EBO::EBO(EBO&& other) noexcept :
+	m_ID{other.m_ID},
+	m_draw_mode{other.m_draw_mode},
+	m_length{other.m_length},
+	m_size{other.m_size}
+{
+	other.m_ID = 0;
+	other.m_length = 0;
+	other.m_size = 0;
+}
+
+EBO& EBO::operator=(EBO&& other) noexcept{
+	if(this != &other){
+		bu_glw_buffer_resized(BU_GLW_MEMORY_INDEX_BUFFERS, m_size, 0);
+		glDeleteBuffers(1, &m_ID);
+		if(m_ID != 0)
+			bu_glw_trace(BU_GLW_TRACE_DELETE_BUFFER, m_ID);
+		m_ID = other.m_ID;
+		m_draw_mode = other.m_draw_mode;
+		m_length = other.m_length;
+		m_size = other.m_size;
+		other.m_ID = 0;
+		other.m_length = 0;
+		other.m_size = 0;
+	}
+	return *this;
 }
 
-void EBO::data(unsigned int* data, GLuint length){
+EBO EBO::adopt(GLuint id, GLenum draw_mode){
+	return EBO(id, draw_mode, 0);
+}
+
+void EBO::data(const unsigned int* data, GLuint length){
+	m_length = length;
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, length*sizeof(unsigned int), data, m_draw_mode);
+	bu_glw_trace_buffer_data(GL_ELEMENT_ARRAY_BUFFER, m_ID, m_draw_mode, length*sizeof(unsigned int), data);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_INDEX_BUFFERS, m_size, length*sizeof(unsigned int));
+}
+
+void EBO::raw_data(const void* data, GLsizeiptr size){
+	m_length = (unsigned int)(size / sizeof(unsigned int));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, m_draw_mode);
+	bu_glw_trace_buffer_data(GL_ELEMENT_ARRAY_BUFFER, m_ID, m_draw_mode, size, data);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_INDEX_BUFFERS, m_size, size);
 }
 
-void EBO::partial_data(GLintptr index, unsigned int* data, GLuint length){
+void EBO::partial_data(GLintptr index, const unsigned int* data, GLuint length){
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
 	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, index, length*sizeof(unsigned int), data);
+	bu_glw_trace_buffer_sub_data(GL_ELEMENT_ARRAY_BUFFER, m_ID, index, length*sizeof(unsigned int), data);
 }
 
 void EBO::bind(){
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ELEMENT_ARRAY_BUFFER, m_ID);
 }
 
 void EBO::unbind(){
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void EBO::map(void (*f)(void*), GLenum mode){
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_ELEMENT_ARRAY_BUFFER, m_ID);
 	void* ptr = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, mode);
 	f(ptr);
 	glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+	if(mode != GL_READ_ONLY) /* It may have been written to. */
+		bu_glw_trace_buffer_contents(GL_ELEMENT_ARRAY_BUFFER, m_ID, m_size);
+}
+
+/************************* SSBO ******************************/
+
+SSBO::SSBO() :
+	m_ID{666}, /* Same evil default as for the other buffers. */
+	m_draw_mode{GL_DYNAMIC_DRAW},
+	m_size{0}
+{
+	bu_glw_gen_buffers(1, &m_ID);
+#if BU_GLW_CONSTRUCTORS_BIND==1 
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_SHADER_STORAGE_BUFFER, m_ID);
+#endif
+}
+
+SSBO::SSBO(const void* data, GLsizeiptr size, GLenum draw_mode) :
+	m_draw_mode{draw_mode},
+	m_size{0}
+{
+	bu_glw_gen_buffers(1, &m_ID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, draw_mode);
+	bu_glw_trace_buffer_data(GL_SHADER_STORAGE_BUFFER, m_ID, draw_mode, size, data);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_STORAGE_BUFFERS, m_size, size);
+}
+
+SSBO::~SSBO(){
+	bu_glw_buffer_resized(BU_GLW_MEMORY_STORAGE_BUFFERS, m_size, 0);
+	glDeleteBuffers(1, &m_ID);
+	if(m_ID != 0)
+		bu_glw_trace(BU_GLW_TRACE_DELETE_BUFFER, m_ID);
+}
+
+SSBO::SSBO(SSBO&& other) noexcept :
+	m_ID{other.m_ID},
+	m_draw_mode{other.m_draw_mode},
+	m_size{other.m_size}
+{
+	other.m_ID = 0;
+	other.m_size = 0;
+}
+
+SSBO& SSBO::operator=(SSBO&& other) noexcept{
+	if(this != &other){
+		bu_glw_buffer_resized(BU_GLW_MEMORY_STORAGE_BUFFERS, m_size, 0);
+		glDeleteBuffers(1, &m_ID);
+		if(m_ID != 0)
+			bu_glw_trace(BU_GLW_TRACE_DELETE_BUFFER, m_ID);
+		m_ID = other.m_ID;
+		m_draw_mode = other.m_draw_mode;
+		m_size = other.m_size;
+		other.m_ID = 0;
+		other.m_size = 0;
+	}
+	return *this;
+}
+
+void SSBO::bind() const{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_SHADER_STORAGE_BUFFER, m_ID);
+}
+
+void SSBO::unbind() const{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SSBO::data(const void* data, GLsizeiptr size){
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, m_draw_mode);
+	bu_glw_trace_buffer_data(GL_SHADER_STORAGE_BUFFER, m_ID, m_draw_mode, size, data);
+	bu_glw_buffer_resized(BU_GLW_MEMORY_STORAGE_BUFFERS, m_size, size);
+}
+
+void SSBO::partial_data(GLintptr offset, const void* data, GLsizeiptr size){
+#if !BU_GLW_NO_BOUNDS_CHECKING
+	if(offset < 0 || offset + size > m_size)
+		throw(BuGlwOutOfBounds());
+#endif
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ID);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+	bu_glw_trace_buffer_sub_data(GL_SHADER_STORAGE_BUFFER, m_ID, offset, size, data);
+}
+
+void SSBO::bind_base(GLuint index) const{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER_BASE, GL_SHADER_STORAGE_BUFFER, index, m_ID);
+}
+
+void SSBO::bind_range(GLuint index, GLintptr offset, GLsizeiptr size) const{
+#if !BU_GLW_NO_BOUNDS_CHECKING
+	if(offset < 0 || size <= 0 || offset + size > m_size)
+		throw(BuGlwOutOfBounds());
+#endif
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, m_ID, offset, size);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER_RANGE, GL_SHADER_STORAGE_BUFFER, index, m_ID, bu_glw_low(offset), bu_glw_high(offset), bu_glw_low(size), bu_glw_high(size));
+}
+
+void SSBO::map(void (*f)(void*), GLenum mode) const{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ID);
+	bu_glw_trace(BU_GLW_TRACE_BIND_BUFFER, GL_SHADER_STORAGE_BUFFER, m_ID);
+	void* ptr = glMapBuffer(GL_SHADER_STORAGE_BUFFER, mode);
+	if(ptr == nullptr)
+		throw(GLNullPointerReturned());
+	f(ptr);
+	glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+	if(mode != GL_READ_ONLY) /* It may have been written to. */
+		bu_glw_trace_buffer_contents(GL_SHADER_STORAGE_BUFFER, m_ID, m_size);
 }
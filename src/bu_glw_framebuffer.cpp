@@ -0,0 +1,393 @@
+/* Framebuffers and render targets for Benoe's Utilities: OpenGL wrappers
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_framebuffer.hpp"
+
+unsigned int bu_glw_internal_format_size(GLenum internal_format){
+	switch(internal_format){
+		case GL_R8:
+		case GL_R8I:
+		case GL_R8UI:
+		case GL_STENCIL_INDEX8:
+			return 1;
+		case GL_RG8:
+		case GL_R16F:
+		case GL_R16:
+		case GL_R16I:
+		case GL_R16UI:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+		case GL_RGB8: /* Usually padded to four bytes. */
+		case GL_SRGB8:
+		case GL_RGB10_A2:
+		case GL_R11F_G11F_B10F:
+		case GL_RG16F:
+		case GL_RG16:
+		case GL_R32F:
+		case GL_R32I:
+		case GL_R32UI:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+			return 4;
+		case GL_RGBA16F:
+		case GL_RGBA16:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_RGBA32F:
+		case GL_RGBA32I:
+		case GL_RGBA32UI:
+			return 16;
+	}
+	return 4;
+}
+
+bool bu_glw_is_depth_format(GLenum internal_format){
+	switch(internal_format){
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return true;
+	}
+	return false;
+}
+
+bool bu_glw_is_stencil_format(GLenum internal_format){
+	return internal_format == GL_STENCIL_INDEX8 || internal_format == GL_DEPTH24_STENCIL8 || internal_format == GL_DEPTH32F_STENCIL8;
+}
+
+/************************** Render targets *************************/
+
+RenderTarget::RenderTarget(const RenderTargetDesc& desc) :
+	m_ID{666}, /* The usual evil default. */
+	m_desc(desc)
+{
+	if(desc.sampled){
+		glGenTextures(1, &m_ID);
+		if(desc.samples > 1){
+			glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_ID);
+			glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, desc.samples, desc.internal_format, desc.width, desc.height, GL_TRUE);
+			glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+		}else{
+			glBindTexture(GL_TEXTURE_2D, m_ID);
+			glTexStorage2D(GL_TEXTURE_2D, 1, desc.internal_format, desc.width, desc.height);
+			GLenum filter = bu_glw_is_depth_format(desc.internal_format) ? GL_NEAREST : GL_LINEAR;
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}else{
+		glGenRenderbuffers(1, &m_ID);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_ID);
+		if(desc.samples > 1)
+			glRenderbufferStorageMultisample(GL_RENDERBUFFER, desc.samples, desc.internal_format, desc.width, desc.height);
+		else
+			glRenderbufferStorage(GL_RENDERBUFFER, desc.internal_format, desc.width, desc.height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	}
+#if BU_GLW_TRACK_MEMORY
+	bu_glw_memory_track(BU_GLW_MEMORY_RENDER_TARGETS, 0, memorySize());
+#endif
+}
+
+RenderTarget::~RenderTarget(){
+	if(m_ID == 0)
+		return; /* Moved from. */
+#if BU_GLW_TRACK_MEMORY
+	bu_glw_memory_track(BU_GLW_MEMORY_RENDER_TARGETS, memorySize(), 0);
+#endif
+	if(m_desc.sampled)
+		glDeleteTextures(1, &m_ID);
+	else
+		glDeleteRenderbuffers(1, &m_ID);
+}
+
+RenderTarget::RenderTarget(RenderTarget&& other) noexcept :
+	m_ID{other.m_ID},
+	m_desc(other.m_desc)
+{
+	other.m_ID = 0;
+}
+
+size_t RenderTarget::memorySize() const{
+	size_t samples = m_desc.samples > 1 ? m_desc.samples : 1;
+	return (size_t)m_desc.width * m_desc.height * samples * bu_glw_internal_format_size(m_desc.internal_format);
+}
+
+/************************** Framebuffer *************************/
+
+/* Index into Framebuffer::m_attachments, -1 for an unknown attachment point. */
+static int bu_glw_attachment_index(GLenum attachment){
+	if(attachment >= GL_COLOR_ATTACHMENT0 && attachment < GL_COLOR_ATTACHMENT0 + BU_GLW_MAX_COLOR_ATTACHMENTS)
+		return attachment - GL_COLOR_ATTACHMENT0;
+	switch(attachment){
+		case GL_DEPTH_ATTACHMENT:         return BU_GLW_MAX_COLOR_ATTACHMENTS;
+		case GL_STENCIL_ATTACHMENT:       return BU_GLW_MAX_COLOR_ATTACHMENTS + 1;
+		case GL_DEPTH_STENCIL_ATTACHMENT: return BU_GLW_MAX_COLOR_ATTACHMENTS + 2;
+	}
+	return -1;
+}
+
+Framebuffer::Framebuffer() :
+	m_ID{666}
+{
+	for(int i = 0; i < BU_GLW_MAX_COLOR_ATTACHMENTS + 3; ++i){
+		m_attachments[i].internal_format = GL_NONE;
+		m_attachments[i].samples = 0;
+	}
+	glGenFramebuffers(1, &m_ID);
+#if BU_GLW_CONSTRUCTORS_BIND==1
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+#endif
+}
+
+Framebuffer::~Framebuffer(){
+	glDeleteFramebuffers(1, &m_ID);
+}
+
+Framebuffer::Framebuffer(Framebuffer&& other) noexcept :
+	m_ID{other.m_ID}
+{
+	for(int i = 0; i < BU_GLW_MAX_COLOR_ATTACHMENTS + 3; ++i)
+		m_attachments[i] = other.m_attachments[i];
+	other.m_ID = 0;
+}
+
+void Framebuffer::attached(GLenum attachment, GLenum internal_format, GLsizei samples){
+	int index = bu_glw_attachment_index(attachment);
+	if(index == -1){
+		fprintf(stderr, "Unknown framebuffer attachment point 0x%x\n", attachment);
+		throw( GLFramebufferIncomplete() );
+	}
+
+	bool depth = bu_glw_is_depth_format(internal_format);
+	bool stencil = bu_glw_is_stencil_format(internal_format);
+	bool fits;
+	if(index < BU_GLW_MAX_COLOR_ATTACHMENTS)
+		fits = !depth && !stencil;
+	else if(attachment == GL_DEPTH_ATTACHMENT)
+		fits = depth;
+	else if(attachment == GL_STENCIL_ATTACHMENT)
+		fits = stencil;
+	else
+		fits = depth && stencil;
+	if(!fits){
+		fprintf(stderr, "Format 0x%x can not be attached to framebuffer attachment point 0x%x\n", internal_format, attachment);
+		throw( GLFramebufferIncomplete() );
+	}
+
+	samples = samples > 1 ? samples : 1;
+	for(int i = 0; i < BU_GLW_MAX_COLOR_ATTACHMENTS + 3; ++i){
+		if(i != index && m_attachments[i].internal_format != GL_NONE && m_attachments[i].samples != samples){
+			fprintf(stderr, "Framebuffer attachments with %d and %d samples can not be mixed\n", m_attachments[i].samples, samples);
+			throw( GLFramebufferIncomplete() );
+		}
+	}
+	m_attachments[index].internal_format = internal_format;
+	m_attachments[index].samples = samples;
+}
+
+void Framebuffer::updateDrawBuffers(){
+	GLenum buffers[BU_GLW_MAX_COLOR_ATTACHMENTS];
+	GLsizei count = 0;
+	for(int i = 0; i < BU_GLW_MAX_COLOR_ATTACHMENTS; ++i)
+		buffers[i] = GL_NONE;
+	for(int i = 0; i < BU_GLW_MAX_COLOR_ATTACHMENTS; ++i){
+		if(m_attachments[i].internal_format != GL_NONE){
+			buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+			count = i + 1;
+		}
+	}
+	if(count == 0){
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}else{
+		glDrawBuffers(count, buffers);
+		glReadBuffer(buffers[0] != GL_NONE ? buffers[0] : GL_NONE);
+	}
+}
+
+void Framebuffer::attach(GLenum attachment, const RenderTarget& target){
+	const RenderTargetDesc& desc = target.desc();
+	attached(attachment, desc.internal_format, desc.samples);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+	if(target.isTexture())
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, target.textureTarget(), target.id(), 0);
+	else
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, target.id());
+	updateDrawBuffers();
+}
+
+void Framebuffer::attachTexture(GLenum attachment, GLuint texture, GLenum internal_format, GLsizei samples, GLint level){
+	attached(attachment, internal_format, samples);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D, texture, level);
+	updateDrawBuffers();
+}
+
+void Framebuffer::detach(GLenum attachment){
+	int index = bu_glw_attachment_index(attachment);
+	if(index == -1)
+		throw( GLFramebufferIncomplete() );
+	m_attachments[index].internal_format = GL_NONE;
+	m_attachments[index].samples = 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, 0);
+	updateDrawBuffers();
+}
+
+void Framebuffer::validate(){
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if(status != GL_FRAMEBUFFER_COMPLETE){
+		fprintf(stderr, "Framebuffer %u is incomplete: 0x%x\n", m_ID, status);
+		throw( GLFramebufferIncomplete() );
+	}
+}
+
+void Framebuffer::bind(GLenum target){
+	glBindFramebuffer(target, m_ID);
+}
+
+void Framebuffer::unbind(GLenum target){
+	glBindFramebuffer(target, 0);
+}
+
+void Framebuffer::discard(const GLenum* attachments, GLsizei count){
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+	glInvalidateFramebuffer(GL_FRAMEBUFFER, count, attachments);
+}
+
+void Framebuffer::discard(GLenum attachment){
+	discard(&attachment, 1);
+}
+
+/************************** Render target pool *************************/
+
+RenderTargetPool::RenderTargetPool(unsigned int max_idle_frames) :
+	m_scratch_framebuffer{0},
+	m_frame{0},
+	m_max_idle_frames{max_idle_frames},
+	m_memory{0},
+	m_peak_memory{0},
+	m_allocations{0},
+	m_reuses{0}
+{
+}
+
+RenderTargetPool::~RenderTargetPool(){
+	glDeleteFramebuffers(1, &m_scratch_framebuffer);
+}
+
+/* The attachment point a renderbuffer of the format goes to. */
+static GLenum bu_glw_default_attachment(GLenum internal_format){
+	if(bu_glw_is_depth_format(internal_format))
+		return bu_glw_is_stencil_format(internal_format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+	if(bu_glw_is_stencil_format(internal_format))
+		return GL_STENCIL_ATTACHMENT;
+	return GL_COLOR_ATTACHMENT0;
+}
+
+void RenderTargetPool::invalidate(Entry& entry){
+	entry.written = false;
+	const RenderTarget& target = entry.target;
+	if(target.isTexture()){
+		glInvalidateTexImage(target.id(), 0);
+		return;
+	}
+
+	/* Attached to the scratch framebuffer only for the call, the draw framebuffer binding is restored afterwards. */
+	if(m_scratch_framebuffer == 0)
+		glGenFramebuffers(1, &m_scratch_framebuffer);
+	GLint bound = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+	GLenum attachment = bu_glw_default_attachment(target.desc().internal_format);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_scratch_framebuffer);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, attachment, GL_RENDERBUFFER, target.id());
+	glInvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, 1, &attachment);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, attachment, GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)bound);
+}
+
+const RenderTarget& RenderTargetPool::acquire(const RenderTargetDesc& desc, int first_pass, int last_pass){
+	for(size_t i = 0; i < m_entries.size(); ++i){
+		Entry& entry = *m_entries[i];
+		if( !(entry.target.desc() == desc) )
+			continue;
+		bool overlaps = false;
+		for(size_t l = 0; l < entry.leases.size() && !overlaps; ++l)
+			overlaps = entry.leases[l].first_pass <= last_pass && first_pass <= entry.leases[l].last_pass;
+		if(overlaps)
+			continue;
+		if(entry.written)
+			invalidate(entry);
+		entry.written = true;
+		entry.leases.push_back( Lease{first_pass, last_pass} );
+		entry.last_used_frame = m_frame;
+		m_reuses++;
+		return entry.target;
+	}
+
+	m_entries.push_back( std::unique_ptr<Entry>(new Entry(desc)) );
+	Entry& entry = *m_entries.back();
+	entry.written = true;
+	entry.leases.push_back( Lease{first_pass, last_pass} );
+	entry.last_used_frame = m_frame;
+	m_allocations++;
+	m_memory += entry.target.memorySize();
+	if(m_memory > m_peak_memory)
+		m_peak_memory = m_memory;
+	return entry.target;
+}
+
+void RenderTargetPool::endFrame(){
+	size_t kept = 0;
+	for(size_t i = 0; i < m_entries.size(); ++i){
+		Entry& entry = *m_entries[i];
+		entry.leases.clear();
+		if(entry.written)
+			invalidate(entry);
+		if(m_frame - entry.last_used_frame > m_max_idle_frames){
+			m_memory -= entry.target.memorySize();
+			m_entries[i].reset();
+		}else{
+			if(kept != i)
+				m_entries[kept] = std::move(m_entries[i]);
+			kept++;
+		}
+	}
+	m_entries.resize(kept);
+	m_frame++;
+}
+
+void RenderTargetPool::clear(){
+	m_entries.clear();
+	m_memory = 0;
+}
+
+RenderTargetPoolStats RenderTargetPool::stats() const{
+	RenderTargetPoolStats stats;
+	stats.targets = m_entries.size();
+	stats.targets_in_use = 0;
+	for(size_t i = 0; i < m_entries.size(); ++i)
+		if( !m_entries[i]->leases.empty() )
+			stats.targets_in_use++;
+	stats.memory = m_memory;
+	stats.peak_memory = m_peak_memory;
+	stats.allocations = m_allocations;
+	stats.reuses = m_reuses;
+	return stats;
+}
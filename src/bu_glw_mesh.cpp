@@ -0,0 +1,123 @@
+/* Binary mesh loading for Benoe's Utilities: OpenGL wrappers
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_mesh.hpp"
+#include <string.h>
+
+/* Whether count elements of element_size bytes starting at offset lie inside a file of the given size, with the offset
+ * aligned to BU_GLW_MESH_ALIGNMENT. Every step is checked so neither count * element_size nor offset + bytes can wrap around. */
+static bool bu_glw_mesh_blob_fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t size){
+	if( offset % BU_GLW_MESH_ALIGNMENT != 0 || offset > size )
+		return false;
+	if( element_size == 0 || count > UINT64_MAX / element_size )
+		return false;
+	uint64_t bytes = count * element_size;
+	return bytes <= size - offset;
+}
+
+const MeshFileHeader* bu_glw_mesh_validate(const unsigned char* file, size_t size){
+	if(file == nullptr || size < sizeof(MeshFileHeader))
+		throw( BuGlwBadMeshFile() );
+
+	const MeshFileHeader* header = (const MeshFileHeader*)file;
+	if( memcmp(header->magic, BU_GLW_MESH_MAGIC, 4) != 0 || header->version != BU_GLW_MESH_VERSION )
+		throw( BuGlwBadMeshFile() );
+	if( header->attribute_count == 0 || header->attribute_count > BU_GLW_MESH_MAX_ATTRIBUTES )
+		throw( BuGlwBadMeshFile() );
+	if( header->index_type != BU_GLW_MESH_UNSIGNED_INT )
+		throw( BuGlwBadMeshFile() );
+
+	/* Everything the attributes hold goes to glVertexAttribPointer unchecked. */
+	uint64_t stride = 0;
+	for(uint32_t i = 0; i < header->attribute_count; ++i){
+		const MeshFileAttribute& attribute = header->attributes[i];
+		if( attribute.num_fields == 0 || attribute.num_fields > 4 )
+			throw( BuGlwBadMeshFile() );
+		uint32_t field_size = bu_glw_mesh_type_size(attribute.field_type);
+		if( field_size == 0 || attribute.field_size != field_size )
+			throw( BuGlwBadMeshFile() );
+		stride += (uint64_t)attribute.field_size * attribute.num_fields;
+	}
+	if(stride == 0 || stride != header->vertex_stride)
+		throw( BuGlwBadMeshFile() );
+
+	/* Mesh hands the counts to GL as GLsizei. */
+	if( header->vertex_count > INT32_MAX || header->index_count > INT32_MAX )
+		throw( BuGlwBadMeshFile() );
+
+	if( !bu_glw_mesh_blob_fits(header->vertex_offset, header->vertex_count, stride, size) )
+		throw( BuGlwBadMeshFile() );
+	if( !bu_glw_mesh_blob_fits(header->index_offset, header->index_count, sizeof(uint32_t), size) )
+		throw( BuGlwBadMeshFile() );
+	if( header->meshlet_count != 0 ){
+		if( !bu_glw_mesh_blob_fits(header->meshlet_offset, header->meshlet_count, sizeof(MeshFileMeshlet), size) )
+			throw( BuGlwBadMeshFile() );
+		const MeshFileMeshlet* meshlets = (const MeshFileMeshlet*)(file + header->meshlet_offset);
+		for(uint32_t i = 0; i < header->meshlet_count; ++i)
+			if( (uint64_t)meshlets[i].index_offset + meshlets[i].index_count > header->index_count )
+				throw( BuGlwBadMeshFile() );
+	}
+	return header;
+}
+
+Mesh::Mesh(const char* path, GLenum draw_mode) :
+	Mesh(MappedFile(path), draw_mode)
+{
+}
+
+static GLuint bu_glw_mesh_gen_buffer(){
+	GLuint id = 0;
+	bu_glw_gen_buffers(1, &id);
+	return id;
+}
+
+Mesh::Mesh(const MappedFile& file, GLenum draw_mode) :
+	m_vbo{VBO::adopt(bu_glw_mesh_gen_buffer(), draw_mode)},
+	m_ebo{EBO::adopt(bu_glw_mesh_gen_buffer(), draw_mode)},
+	m_vertex_count{0},
+	m_index_count{0}
+{
+	const MeshFileHeader* header = bu_glw_mesh_validate(file.data(), file.size());
+	m_vertex_count = (GLsizei)header->vertex_count;
+	m_index_count = (GLsizei)header->index_count;
+
+	/* The EBO binding is recorded by the VAO, so it has to be bound first. */
+	m_vao.bind();
+	m_vbo.raw_data(file.data() + header->vertex_offset, (GLsizeiptr)(header->vertex_count * header->vertex_stride));
+	m_ebo.raw_data(file.data() + header->index_offset, (GLsizeiptr)(header->index_count * sizeof(uint32_t)));
+
+	for(uint32_t i = 0; i < header->attribute_count; ++i){
+		const MeshFileAttribute& attribute = header->attributes[i];
+		m_vao.add_attribute( VertexAttrib{attribute.num_fields, attribute.field_type, attribute.field_size, (GLboolean)(attribute.normalized ? GL_TRUE : GL_FALSE)} );
+	}
+	/* m_vbo is still bound to GL_ARRAY_BUFFER after raw_data. */
+	m_vao.bind_attributes();
+
+	if(header->meshlet_count != 0){
+		const MeshFileMeshlet* meshlets = (const MeshFileMeshlet*)(file.data() + header->meshlet_offset);
+		m_meshlets.assign(meshlets, meshlets + header->meshlet_count);
+	}
+}
+
+void Mesh::bind(){
+	m_vao.bind();
+}
+
+void Mesh::draw(GLenum mode){
+	m_vao.bind();
+	bu_glw_draw_elements(mode, m_index_count, GL_UNSIGNED_INT);
+}
+
+void Mesh::drawMeshlet(size_t index, GLenum mode){
+#if !BU_GLW_NO_BOUNDS_CHECKING
+	if(index >= m_meshlets.size())
+		throw(BuGlwOutOfBounds());
+#endif
+	m_vao.bind();
+	const MeshFileMeshlet& meshlet = m_meshlets[index];
+	bu_glw_draw_elements(mode, (GLsizei)meshlet.index_count, GL_UNSIGNED_INT, (GLintptr)(meshlet.index_offset * sizeof(uint32_t)));
+}
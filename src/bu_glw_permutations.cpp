@@ -0,0 +1,162 @@
+/* Shader permutations for Benoe's Utilities: OpenGL wrappers
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_permutations.hpp"
+#include <ctype.h>
+#include <string.h>
+#include <tuple>
+#include <utility>
+
+/* If a directive starts at source, whether it is #version. Whitespace may separate the # from the name. */
+static bool bu_glw_is_version_directive(const char* source){
+	if(*source != '#')
+		return false;
+	source++;
+	while(*source == ' ' || *source == '\t')
+		source++;
+	if(strncmp(source, "version", 7) != 0)
+		return false;
+	char next = source[7];
+	return !(isalnum((unsigned char)next) || next == '_');
+}
+
+void PermutationSource::split(const char* source){
+	code = source;
+	version_length = 0;
+
+	/* #version counts only as the first token of a line, outside of comments. Comments count as whitespace
+	 * there, as they do for the preprocessor, so it may follow a block comment ending on the same line. */
+	bool line_start = true;
+	const char* version = nullptr;
+	for(const char* c = source; *c != '\0' && version == nullptr; ){
+		if(c[0] == '/' && c[1] == '*'){
+			const char* end = strstr(c + 2, "*/");
+			if(end == nullptr)
+				break;
+			/* A newline inside the comment still ends the line. */
+			for(const char* inside = c + 2; inside < end; ++inside)
+				if(*inside == '\n')
+					line_start = true;
+			c = end + 2;
+		}else if(c[0] == '/' && c[1] == '/'){
+			while(*c != '\0' && *c != '\n')
+				c++;
+		}else if(*c == '\n'){
+			line_start = true;
+			c++;
+		}else if(*c == ' ' || *c == '\t' || *c == '\r' || *c == '\v' || *c == '\f'){
+			c++;
+		}else{
+			if(line_start && bu_glw_is_version_directive(c))
+				version = c;
+			line_start = false;
+			c++;
+		}
+	}
+	if(version != nullptr){
+		const char* newline = strchr(version, '\n');
+		version_length = newline != nullptr ? (GLint)(newline - source + 1) : (GLint)strlen(source);
+	}
+
+	unsigned int line = 1;
+	for(GLint i = 0; i < version_length; ++i)
+		if(source[i] == '\n')
+			line++;
+	snprintf(line_directive, sizeof(line_directive), "#line %u\n", line);
+}
+
+GLsizei PermutationSource::strings(const std::vector<std::string>& defines, uint64_t mask, const GLchar** strings, GLint* lengths) const{
+	/* version line, its newline if the source ends with it, one string per enabled feature, #line, rest of the source */
+	GLsizei count = 0;
+	if(version_length > 0){
+		strings[count] = code;
+		lengths[count] = version_length;
+		count++;
+		if(code[version_length - 1] != '\n'){
+			strings[count] = "\n";
+			lengths[count] = 1;
+			count++;
+		}
+	}
+	for(unsigned int i = 0; i < defines.size() && i < BU_GLW_MAX_SHADER_FEATURES; ++i){
+		if( (mask >> i) & 1 ){
+			strings[count] = defines[i].c_str();
+			lengths[count] = (GLint)defines[i].size();
+			count++;
+		}
+	}
+	strings[count] = line_directive;
+	lengths[count] = -1;
+	count++;
+	strings[count] = code + version_length;
+	lengths[count] = -1; /* Null terminated. */
+	count++;
+	return count;
+}
+
+ShaderPermutations::ShaderPermutations(const PermutationSources& sources, const char* const* feature_names, unsigned int feature_count) :
+	m_vs_code{sources.vertex},
+	m_fs_code{sources.fragment}
+{
+	if(feature_count > BU_GLW_MAX_SHADER_FEATURES)
+		throw(BuGlwOutOfBounds());
+
+	m_defines.reserve(feature_count);
+	for(unsigned int i = 0; i < feature_count; ++i)
+		m_defines.push_back( std::string("#define ") + feature_names[i] + " 1\n" );
+
+	m_vs_source.split(m_vs_code.c_str());
+	m_fs_source.split(m_fs_code.c_str());
+}
+
+/* The whole file as a string, for the path constructor to hand on. */
+static std::string bu_glw_read_permutation_source(const char* path){
+	char* code = bu_glw_read_file_into_string(path);
+	std::string source(code);
+	free(code);
+	return source;
+}
+
+ShaderPermutations::ShaderPermutations(const char* vs_path, const char* fs_path, const char* const* feature_names, unsigned int feature_count) :
+	ShaderPermutations(PermutationSources{bu_glw_read_permutation_source(vs_path).c_str(), bu_glw_read_permutation_source(fs_path).c_str()},
+	                   feature_names, feature_count)
+{
+}
+
+void ShaderPermutations::compileStage(Shader& shader, const PermutationSource& source, uint64_t mask){
+	const GLchar* strings[BU_GLW_MAX_PERMUTATION_STRINGS];
+	GLint lengths[BU_GLW_MAX_PERMUTATION_STRINGS];
+	GLsizei count = source.strings(m_defines, mask, strings, lengths);
+	shader.compile(count, strings, lengths);
+}
+
+ShaderProgram& ShaderPermutations::get(uint64_t mask){
+	std::unordered_map<uint64_t, ShaderProgram>::iterator found = m_programs.find(mask);
+	if(found != m_programs.end())
+		return found->second;
+
+#if !BU_GLW_NO_BOUNDS_CHECKING
+	if(m_defines.size() < 64 && (mask >> m_defines.size()) != 0)
+		throw(BuGlwOutOfBounds());
+#endif
+
+	VertexShader vs(nullptr);
+	FragmentShader fs(nullptr);
+	compileStage(vs, m_vs_source, mask);
+	compileStage(fs, m_fs_source, mask);
+
+	return m_programs.emplace(
+		std::piecewise_construct,
+		std::forward_as_tuple(mask),
+		std::forward_as_tuple(vs, fs)
+	).first->second;
+}
+
+void ShaderPermutations::warmUp(const uint64_t* masks, size_t count){
+	for(size_t i = 0; i < count; ++i)
+		get(masks[i]);
+}
@@ -0,0 +1,122 @@
+/* Resource pools for Benoe's Utilities: OpenGL wrappers
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_pool.hpp"
+
+/************************** Name reserve *************************/
+
+GLNameReserve::GLNameReserve(GLNameKind kind, GLsizei batch) :
+	m_kind{kind},
+	m_batch{batch > 0 ? batch : 1}
+{
+}
+
+GLNameReserve::~GLNameReserve(){
+	if(m_names.empty())
+		return;
+	switch(m_kind){
+		case BU_GLW_BUFFER_NAMES:
+			glDeleteBuffers((GLsizei)m_names.size(), m_names.data());
+			break;
+		case BU_GLW_VERTEX_ARRAY_NAMES:
+			glDeleteVertexArrays((GLsizei)m_names.size(), m_names.data());
+			break;
+	}
+}
+
+void GLNameReserve::generate(GLsizei count){
+	if(count <= 0)
+		return;
+	size_t old_size = m_names.size();
+	m_names.resize(old_size + count);
+	GLuint* names = m_names.data() + old_size;
+	/* The glCreate* variants also create the objects, so the first bind does not have to. */
+	switch(m_kind){
+		case BU_GLW_BUFFER_NAMES:
+#if BU_GLW_GL_VERSION_AT_LEAST(4, 5)
+			bu_glw_create_buffers(count, names);
+#else
+			bu_glw_gen_buffers(count, names);
+#endif
+			break;
+		case BU_GLW_VERTEX_ARRAY_NAMES:
+#if BU_GLW_GL_VERSION_AT_LEAST(4, 5)
+			bu_glw_create_vertex_arrays(count, names);
+#else
+			bu_glw_gen_vertex_arrays(count, names);
+#endif
+			break;
+	}
+}
+
+GLuint GLNameReserve::take(){
+	if(m_names.empty())
+		generate(m_batch);
+	GLuint name = m_names.back();
+	m_names.pop_back();
+	return name;
+}
+
+/******************************** VBO pool *************************************/
+
+ResourceHandle<VBO> VBOPool::create(GLenum draw_mode){
+	ResourceHandle<VBO> handle = insert( VBO::adopt(m_names.take(), draw_mode) );
+#if BU_GLW_CONSTRUCTORS_BIND==1
+	get(handle)->bind();
+#endif
+	return handle;
+}
+
+ResourceHandle<VBO> VBOPool::create(const float* array, GLuint length, GLenum draw_mode){
+	ResourceHandle<VBO> handle = insert( VBO::adopt(m_names.take(), draw_mode) );
+	get(handle)->data(array, length);
+	return handle;
+}
+
+void VBOPool::prepare(GLsizei count){
+	reserve(size() + count);
+	if(m_names.available() < (size_t)count)
+		m_names.generate(count - (GLsizei)m_names.available());
+}
+
+/******************************** EBO pool *************************************/
+
+ResourceHandle<EBO> EBOPool::create(GLenum draw_mode){
+	ResourceHandle<EBO> handle = insert( EBO::adopt(m_names.take(), draw_mode) );
+#if BU_GLW_CONSTRUCTORS_BIND==1
+	get(handle)->bind();
+#endif
+	return handle;
+}
+
+ResourceHandle<EBO> EBOPool::create(const unsigned int* array, GLuint length, GLenum draw_mode){
+	ResourceHandle<EBO> handle = insert( EBO::adopt(m_names.take(), draw_mode) );
+	get(handle)->data(array, length);
+	return handle;
+}
+
+void EBOPool::prepare(GLsizei count){
+	reserve(size() + count);
+	if(m_names.available() < (size_t)count)
+		m_names.generate(count - (GLsizei)m_names.available());
+}
+
+/******************************** VAO pool *************************************/
+
+ResourceHandle<VAO> VAOPool::create(){
+	ResourceHandle<VAO> handle = insert( VAO::adopt(m_names.take()) );
+#if BU_GLW_CONSTRUCTORS_BIND==1
+	get(handle)->bind();
+#endif
+	return handle;
+}
+
+void VAOPool::prepare(GLsizei count){
+	reserve(size() + count);
+	if(m_names.available() < (size_t)count)
+		m_names.generate(count - (GLsizei)m_names.available());
+}
@@ -0,0 +1,323 @@
+/* Asynchronous framebuffer readback for Benoe's Utilities: OpenGL wrappers
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_readback.hpp"
+#include <stdio.h>
+
+unsigned int bu_glw_pixel_size(GLenum format, GLenum type){
+	unsigned int channels;
+	switch(format){
+		case GL_RED:
+		case GL_GREEN:
+		case GL_BLUE:
+		case GL_DEPTH_COMPONENT:
+		case GL_STENCIL_INDEX:
+			channels = 1; break;
+		case GL_RG:
+			channels = 2; break;
+		case GL_RGB:
+		case GL_BGR:
+			channels = 3; break;
+		case GL_RGBA:
+		case GL_BGRA:
+			channels = 4; break;
+		default:
+			return 0;
+	}
+	switch(type){
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+			return channels;
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+			return channels * 2;
+		case GL_UNSIGNED_INT:
+		case GL_INT:
+		case GL_FLOAT:
+			return channels * 4;
+		case GL_UNSIGNED_INT_8_8_8_8:
+		case GL_UNSIGNED_INT_8_8_8_8_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+			return channels == 4 ? 4 : 0;
+	}
+	return 0;
+}
+
+static double bu_glw_milliseconds(std::chrono::steady_clock::duration duration){
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+FrameReadback::FrameReadback(ReadbackCallback callback, void* user_data, const ReadbackOptions& options) :
+	m_options{options},
+	m_callback{callback},
+	m_user_data{user_data},
+	m_slots(options.ring_size > 1 ? options.ring_size : 2),
+	m_head{0},
+	m_tail{0},
+	m_frame_number{0},
+	m_stopping{false},
+	m_stats(),
+	m_total_latency_ms{0},
+	m_total_callback_ms{0}
+{
+	if(bu_glw_pixel_size(options.format, options.type) == 0)
+		throw( GLUnsupportedFormat() );
+	if(m_options.latency_frames >= m_slots.size())
+		m_options.latency_frames = (unsigned int)m_slots.size() - 1;
+
+	std::vector<GLuint> buffers(m_slots.size());
+	glGenBuffers((GLsizei)buffers.size(), buffers.data());
+	for(size_t i = 0; i < m_slots.size(); ++i){
+		m_slots[i].buffer = buffers[i];
+		m_slots[i].capacity = 0;
+		m_slots[i].fence = 0;
+		m_slots[i].state = BU_GLW_SLOT_FREE;
+		m_slots[i].size = 0;
+	}
+
+	m_worker = std::thread(&FrameReadback::work, this);
+}
+
+FrameReadback::~FrameReadback(){
+	/* A destructor must not throw. If delivering fails, the frames left are dropped and everything is still released;
+	 * deleting a buffer unmaps it. */
+	try{
+		flush();
+	}catch(const std::exception& e){
+		fprintf(stderr, "FrameReadback: dropping the frames still in flight, flushing failed: %s\n", e.what());
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_work_ready.notify_one();
+	m_worker.join();
+	unmapConsumed();
+
+	for(size_t i = 0; i < m_slots.size(); ++i){
+		if(m_slots[i].fence != 0)
+			glDeleteSync(m_slots[i].fence);
+		glDeleteBuffers(1, &m_slots[i].buffer);
+#if BU_GLW_TRACK_MEMORY
+		bu_glw_memory_track(BU_GLW_MEMORY_READBACK_BUFFERS, m_slots[i].capacity, 0);
+#endif
+	}
+}
+
+void FrameReadback::work(){
+	for(;;){
+		unsigned int index;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_work_ready.wait(lock, [this]{ return m_stopping || !m_queue.empty(); });
+			if(m_queue.empty())
+				return; /* Only when stopping. */
+			index = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		Slot& slot = m_slots[index];
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		m_callback(slot.frame, m_user_data);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(m_stats_mutex);
+			double latency = bu_glw_milliseconds(start - slot.capture_time);
+			m_stats.frames_delivered++;
+			m_stats.bytes_delivered += slot.size;
+			m_total_latency_ms += latency;
+			m_total_callback_ms += bu_glw_milliseconds(end - start);
+			if(latency > m_stats.max_latency_ms)
+				m_stats.max_latency_ms = latency;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			slot.state = BU_GLW_SLOT_CONSUMED;
+		}
+		m_work_done.notify_all();
+	}
+}
+
+void FrameReadback::unmapConsumed(){
+	for(size_t i = 0; i < m_slots.size(); ++i){
+		if(m_slots[i].state == BU_GLW_SLOT_CONSUMED){
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			m_slots[i].state = BU_GLW_SLOT_FREE;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameReadback::resolve(bool block){
+	while(m_slots[m_tail].state == BU_GLW_SLOT_PENDING){
+		Slot& slot = m_slots[m_tail];
+		if(!block && m_frame_number - slot.frame.frame_number < m_options.latency_frames)
+			return;
+
+		GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, block ? GL_TIMEOUT_IGNORED : 0);
+		if(status == GL_TIMEOUT_EXPIRED)
+			return;
+		if(status == GL_WAIT_FAILED){
+			fprintf(stderr, "FrameReadback: waiting for the fence of frame %llu failed.\n", (unsigned long long)slot.frame.frame_number);
+			throw( BuGlwRealBad() );
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		const unsigned char* mapped = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if(mapped == nullptr){
+			fprintf(stderr, "FrameReadback: mapping the pack buffer of frame %llu failed.\n", (unsigned long long)slot.frame.frame_number);
+			throw( GLNullPointerReturned() );
+		}
+
+		if(m_options.flip_vertically && slot.frame.height > 0){
+			slot.frame.data = mapped + (ptrdiff_t)(slot.frame.height - 1) * slot.frame.stride;
+			slot.frame.stride = -slot.frame.stride;
+		}else{
+			slot.frame.data = mapped;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			slot.state = BU_GLW_SLOT_MAPPED;
+			m_queue.push_back(m_tail);
+		}
+		m_work_ready.notify_one();
+		m_tail = (m_tail + 1) % m_slots.size();
+	}
+}
+
+void FrameReadback::waitForSlot(Slot& slot){
+	for(;;){
+		unmapConsumed();
+		if(slot.state == BU_GLW_SLOT_FREE)
+			return;
+		if(slot.state == BU_GLW_SLOT_PENDING){
+			resolve(true);
+			continue;
+		}
+		/* Mapped, the worker still has to get through it. */
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_work_done.wait(lock, [&slot]{ return slot.state == BU_GLW_SLOT_CONSUMED; });
+	}
+}
+
+bool FrameReadback::capture(GLint x, GLint y, GLsizei width, GLsizei height){
+	/* Before the frame is counted. A negative size would wrap the buffer size below around. */
+	if(width <= 0 || height <= 0)
+		throw(BuGlwOutOfBounds());
+
+	uint64_t frame_number = m_frame_number++;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(m_stats_mutex);
+		if(m_stats.frames_captured == 0 && m_stats.frames_dropped == 0)
+			m_first_capture = now;
+	}
+
+	unmapConsumed();
+	resolve(false);
+
+	Slot& slot = m_slots[m_head];
+	if(slot.state != BU_GLW_SLOT_FREE){
+		if(m_options.drop_when_full){
+			std::lock_guard<std::mutex> lock(m_stats_mutex);
+			m_stats.frames_dropped++;
+			return false;
+		}
+		waitForSlot(slot);
+	}
+
+	/* Rows are padded to GL_PACK_ALIGNMENT. The other pack parameters which change the layout are reset around the read
+	 * below, the frame is always tightly packed apart from that. */
+	GLint alignment = 4;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+	ptrdiff_t row = (ptrdiff_t)width * bu_glw_pixel_size(m_options.format, m_options.type);
+	ptrdiff_t stride = (row + alignment - 1) / alignment * alignment;
+
+	slot.size = (GLsizeiptr)(stride * height);
+	slot.frame.data = nullptr;
+	slot.frame.stride = stride;
+	slot.frame.width = width;
+	slot.frame.height = height;
+	slot.frame.format = m_options.format;
+	slot.frame.type = m_options.type;
+	slot.frame.frame_number = frame_number;
+	slot.capture_time = now;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	if(slot.capacity < slot.size){
+		glBufferData(GL_PIXEL_PACK_BUFFER, slot.size, NULL, GL_STREAM_READ);
+#if BU_GLW_TRACK_MEMORY
+		bu_glw_memory_track(BU_GLW_MEMORY_READBACK_BUFFERS, slot.capacity, slot.size);
+#endif
+		slot.capacity = slot.size;
+	}
+	static const GLenum layout_parameters[3] = { GL_PACK_ROW_LENGTH, GL_PACK_SKIP_ROWS, GL_PACK_SKIP_PIXELS };
+	GLint saved[3] = {0, 0, 0};
+	for(int i = 0; i < 3; ++i){
+		glGetIntegerv(layout_parameters[i], &saved[i]);
+		if(saved[i] != 0)
+			glPixelStorei(layout_parameters[i], 0);
+	}
+	glReadPixels(x, y, width, height, m_options.format, m_options.type, (void*)0);
+	for(int i = 0; i < 3; ++i)
+		if(saved[i] != 0)
+			glPixelStorei(layout_parameters[i], saved[i]);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.state = BU_GLW_SLOT_PENDING;
+	m_head = (m_head + 1) % m_slots.size();
+
+	{
+		std::lock_guard<std::mutex> lock(m_stats_mutex);
+		m_stats.frames_captured++;
+	}
+	return true;
+}
+
+void FrameReadback::poll(){
+	unmapConsumed();
+	resolve(false);
+}
+
+void FrameReadback::flush(){
+	resolve(true);
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_work_done.wait(lock, [this]{
+			for(size_t i = 0; i < m_slots.size(); ++i)
+				if(m_slots[i].state == BU_GLW_SLOT_MAPPED)
+					return false;
+			return true;
+		});
+	}
+	unmapConsumed();
+}
+
+ReadbackStats FrameReadback::stats() const{
+	std::lock_guard<std::mutex> lock(m_stats_mutex);
+	ReadbackStats stats = m_stats;
+	if(stats.frames_delivered != 0){
+		stats.average_latency_ms = m_total_latency_ms / stats.frames_delivered;
+		stats.average_callback_ms = m_total_callback_ms / stats.frames_delivered;
+	}
+	if(stats.frames_captured != 0 || stats.frames_dropped != 0){
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_first_capture).count();
+		if(seconds > 0){
+			stats.frames_per_second = stats.frames_delivered / seconds;
+			stats.megabytes_per_second = stats.bytes_delivered / seconds / (1024.0 * 1024.0);
+		}
+	}
+	return stats;
+}
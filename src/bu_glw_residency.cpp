@@ -0,0 +1,268 @@
+/* Buffer residency management for Benoe's Utilities: OpenGL wrappers
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_residency.hpp"
+#include <string.h>
+
+#define BU_GLW_RESIDENCY_NONE 0xFFFFFFFFu
+
+ResidencyManager::ResidencyManager(size_t budget, size_t upload_budget) :
+	m_lru_head{BU_GLW_RESIDENCY_NONE},
+	m_lru_tail{BU_GLW_RESIDENCY_NONE},
+	m_upload_budget{upload_budget},
+	m_frame{0},
+	m_stats()
+{
+	m_stats.budget = budget;
+}
+
+ResidencyManager::~ResidencyManager(){
+	for(size_t i = 0; i < m_entries.size(); ++i)
+		if(m_entries[i].alive && m_entries[i].owns_data)
+			free((void*)m_entries[i].data);
+}
+
+ResidencyManager::Entry* ResidencyManager::find(ResidentBuffer buffer){
+	if(buffer.index >= m_entries.size())
+		return nullptr;
+	Entry& entry = m_entries[buffer.index];
+	if(!entry.alive || entry.generation != buffer.generation)
+		return nullptr;
+	return &entry;
+}
+
+bool ResidencyManager::pooled(const Entry& entry) const{
+	return entry.vbo_pool != nullptr ? entry.vbo_pool->valid(entry.vbo) : entry.ebo_pool->valid(entry.ebo);
+}
+
+/* The buffer's storage is respecified with the bindings of the application left as they were: raw_data() binds the buffer
+ * to its target, and for an EBO that binding would end up in whatever VAO is bound, so VAO 0 is bound for it.
+ * Does nothing if the buffer is no longer in its pool, its storage went with it. */
+void ResidencyManager::store(Entry& entry, const void* data, size_t size){
+	if(entry.vbo_pool != nullptr){
+		VBO* vbo = entry.vbo_pool->get(entry.vbo);
+		if(vbo == nullptr)
+			return;
+		GLint bound = 0;
+		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &bound);
+		vbo->raw_data(data, (GLsizeiptr)size);
+		if((GLuint)bound != vbo->id())
+			bu_glw_bind_buffer(GL_ARRAY_BUFFER, (GLuint)bound);
+		return;
+	}
+	EBO* ebo = entry.ebo_pool->get(entry.ebo);
+	if(ebo == nullptr)
+		return;
+	GLint vao = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+	if(vao != 0)
+		bu_glw_bind_vertex_array(0);
+	GLint bound = 0;
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &bound);
+	ebo->raw_data(data, (GLsizeiptr)size);
+	if((GLuint)bound != ebo->id())
+		bu_glw_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, (GLuint)bound);
+	if(vao != 0)
+		bu_glw_bind_vertex_array((GLuint)vao);
+}
+
+void ResidencyManager::link(uint32_t index){
+	Entry& entry = m_entries[index];
+	entry.previous = BU_GLW_RESIDENCY_NONE;
+	entry.next = m_lru_head;
+	if(m_lru_head != BU_GLW_RESIDENCY_NONE)
+		m_entries[m_lru_head].previous = index;
+	m_lru_head = index;
+	if(m_lru_tail == BU_GLW_RESIDENCY_NONE)
+		m_lru_tail = index;
+}
+
+void ResidencyManager::unlink(uint32_t index){
+	Entry& entry = m_entries[index];
+	if(entry.previous != BU_GLW_RESIDENCY_NONE)
+		m_entries[entry.previous].next = entry.next;
+	else
+		m_lru_head = entry.next;
+	if(entry.next != BU_GLW_RESIDENCY_NONE)
+		m_entries[entry.next].previous = entry.previous;
+	else
+		m_lru_tail = entry.previous;
+	entry.previous = BU_GLW_RESIDENCY_NONE;
+	entry.next = BU_GLW_RESIDENCY_NONE;
+}
+
+void ResidencyManager::evict(uint32_t index){
+	Entry& entry = m_entries[index];
+	unlink(index);
+	store(entry, NULL, 0);
+	entry.resident = false;
+	m_stats.resident_bytes -= entry.size;
+	m_stats.resident_buffers--;
+	m_stats.evictions++;
+	m_stats.bytes_evicted += entry.size;
+}
+
+bool ResidencyManager::makeRoom(size_t size){
+	while(m_stats.resident_bytes + size > m_stats.budget){
+		if(m_lru_tail == BU_GLW_RESIDENCY_NONE || m_entries[m_lru_tail].last_used_frame == m_frame)
+			return false;
+		evict(m_lru_tail);
+	}
+	return true;
+}
+
+void ResidencyManager::upload(uint32_t index){
+	Entry& entry = m_entries[index];
+	if( !makeRoom(entry.size) )
+		m_stats.over_budget_uploads++;
+	store(entry, entry.data, entry.size);
+	entry.resident = true;
+	link(index);
+	m_stats.resident_bytes += entry.size;
+	m_stats.resident_buffers++;
+	if(m_stats.resident_bytes > m_stats.peak_resident_bytes)
+		m_stats.peak_resident_bytes = m_stats.resident_bytes;
+	m_stats.uploads++;
+	m_stats.bytes_uploaded += entry.size;
+	m_stats.uploaded_this_frame += entry.size;
+}
+
+ResidentBuffer ResidencyManager::add(VBOPool* vbo_pool, ResourceHandle<VBO> vbo, EBOPool* ebo_pool, ResourceHandle<EBO> ebo,
+                                     const void* data, size_t size, ResidencyBacking backing){
+	if( !(vbo_pool != nullptr ? vbo_pool->valid(vbo) : ebo_pool->valid(ebo)) )
+		throw(BuGlwStaleHandle());
+	if(data == nullptr && size != 0){
+		fprintf(stderr, "ResidencyManager::add: no data given for a buffer of %zu bytes.\n", size);
+		throw(BuGlwNullArgument());
+	}
+	uint32_t index;
+	if(!m_free_entries.empty()){
+		index = m_free_entries.back();
+		m_free_entries.pop_back();
+	}else{
+		index = (uint32_t)m_entries.size();
+		m_entries.push_back(Entry());
+		m_entries[index].generation = 0;
+	}
+	Entry& entry = m_entries[index];
+	entry.vbo_pool = vbo_pool;
+	entry.ebo_pool = ebo_pool;
+	entry.vbo = vbo;
+	entry.ebo = ebo;
+	entry.size = size;
+	entry.last_used_frame = 0;
+	entry.previous = BU_GLW_RESIDENCY_NONE;
+	entry.next = BU_GLW_RESIDENCY_NONE;
+	entry.alive = true;
+	entry.resident = false;
+	entry.requested = false;
+	entry.owns_data = backing == BU_GLW_BACKING_COPY;
+	if(entry.owns_data){
+		void* copy = malloc(size > 0 ? size : 1);
+		if(copy == nullptr){
+			entry.alive = false;
+			m_free_entries.push_back(index);
+			throw(BuGlwMemoryError());
+		}
+		if(size != 0)
+			memcpy(copy, data, size);
+		entry.data = copy;
+	}else{
+		entry.data = data;
+	}
+
+	store(entry, NULL, 0);
+	m_stats.registered_bytes += size;
+	m_stats.registered_buffers++;
+	return ResidentBuffer{index, entry.generation};
+}
+
+ResidentBuffer ResidencyManager::add(VBOPool& pool, ResourceHandle<VBO> vbo, const void* data, size_t size, ResidencyBacking backing){
+	return add(&pool, vbo, nullptr, ResourceHandle<EBO>{0, 0}, data, size, backing);
+}
+
+ResidentBuffer ResidencyManager::add(EBOPool& pool, ResourceHandle<EBO> ebo, const void* data, size_t size, ResidencyBacking backing){
+	return add(nullptr, ResourceHandle<VBO>{0, 0}, &pool, ebo, data, size, backing);
+}
+
+void ResidencyManager::remove(ResidentBuffer buffer){
+	Entry* entry = find(buffer);
+	if(entry == nullptr)
+		return;
+	if(entry->resident){
+		unlink(buffer.index);
+		m_stats.resident_bytes -= entry->size;
+		m_stats.resident_buffers--;
+	}
+	if(entry->owns_data)
+		free((void*)entry->data);
+	m_stats.registered_bytes -= entry->size;
+	m_stats.registered_buffers--;
+	entry->alive = false;
+	entry->generation++;
+	m_free_entries.push_back(buffer.index);
+	/* A pending request is skipped by endFrame(), as the entry is no longer alive or has a new generation. */
+}
+
+bool ResidencyManager::use(ResidentBuffer buffer){
+	Entry* entry = find(buffer);
+	if(entry == nullptr || !pooled(*entry))
+		throw(BuGlwStaleHandle());
+	entry->last_used_frame = m_frame;
+	if(entry->resident){
+		/* Move to the front of the LRU list. */
+		if(m_lru_head != buffer.index){
+			unlink(buffer.index);
+			link(buffer.index);
+		}
+		return true;
+	}
+
+	if(m_stats.uploaded_this_frame == 0 || m_stats.uploaded_this_frame + entry->size <= m_upload_budget){
+		upload(buffer.index);
+		return true;
+	}
+
+	m_stats.deferred_uploads++;
+	if(!entry->requested){
+		entry->requested = true;
+		m_requests.push_back(buffer.index);
+	}
+	return false;
+}
+
+bool ResidencyManager::isResident(ResidentBuffer buffer){
+	Entry* entry = find(buffer);
+	return entry != nullptr && entry->resident;
+}
+
+void ResidencyManager::endFrame(){
+	m_frame++;
+	m_stats.uploaded_this_frame = 0;
+	/* Nothing has been used in the new frame yet, so everything may be evicted. */
+	makeRoom(0);
+
+	size_t handled = 0;
+	for(; handled < m_requests.size(); ++handled){
+		Entry& entry = m_entries[ m_requests[handled] ];
+		if(!entry.alive || !entry.requested || entry.resident || !pooled(entry)){
+			entry.requested = false;
+			continue;
+		}
+		if(m_stats.uploaded_this_frame != 0 && m_stats.uploaded_this_frame + entry.size > m_upload_budget)
+			break;
+		entry.requested = false;
+		/* It was wanted last frame, count that as its last use so it is not the first to go. */
+		entry.last_used_frame = m_frame - 1;
+		upload(m_requests[handled]);
+	}
+	m_requests.erase(m_requests.begin(), m_requests.begin() + handled);
+}
+
+void ResidencyManager::setBudget(size_t budget){
+	m_stats.budget = budget;
+}
@@ -0,0 +1,278 @@
+/* Trace writing and reading for Benoe's Utilities: OpenGL wrappers
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_trace.hpp"
+#include <string.h>
+
+static inline uint32_t bu_glw_trace_low(uint64_t value){ return (uint32_t)value; }
+static inline uint32_t bu_glw_trace_high(uint64_t value){ return (uint32_t)(value >> 32); }
+
+/******************************* Writing ********************************/
+
+TraceWriter::TraceWriter(TraceHashFunction hash, size_t payload_memory) :
+	m_hash{hash},
+	m_file{NULL},
+	m_kept_bytes{0},
+	m_payload_memory{payload_memory},
+	m_enabled{false},
+	m_stopping{false},
+	m_failed{false}
+{
+}
+
+TraceWriter::~TraceWriter(){
+	try{
+		end();
+	}catch(BuGlwIOError&){
+		/* Already reported by end(). */
+	}
+}
+
+void TraceWriter::writeLoop(){
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for(;;){
+		m_ready.wait(lock, [this]{ return m_stopping || !m_full.empty(); });
+		if(m_full.empty())
+			return; /* Only when stopping. */
+		std::vector<unsigned char> chunk = std::move(m_full.front());
+		m_full.pop_front();
+		lock.unlock();
+
+		if(fwrite(chunk.data(), 1, chunk.size(), m_file) != chunk.size())
+			m_failed = true;
+		chunk.clear();
+
+		lock.lock();
+		m_spare.push_back(std::move(chunk));
+	}
+}
+
+/* m_mutex must be held. */
+void TraceWriter::handOff(){
+	if(m_chunk.empty())
+		return;
+	m_full.push_back(std::move(m_chunk));
+	if(!m_spare.empty()){
+		m_chunk = std::move(m_spare.back());
+		m_spare.pop_back();
+	}else{
+		m_chunk = std::vector<unsigned char>();
+		m_chunk.reserve(BU_GLW_TRACE_CHUNK_SIZE);
+	}
+	m_ready.notify_one();
+}
+
+/* m_mutex must be held. */
+void TraceWriter::append(const void* data, size_t size){
+	const unsigned char* bytes = (const unsigned char*)data;
+	m_chunk.insert(m_chunk.end(), bytes, bytes + size);
+}
+
+/* Keep a copy of the newest candidate of the key, forgetting the oldest payloads to stay within m_payload_memory.
+ * A payload larger than that is not kept. m_mutex must be held. */
+void TraceWriter::keep(const PayloadKey& key, const void* data, size_t size){
+	if(size > m_payload_memory)
+		return;
+	while(m_kept_bytes + size > m_payload_memory){
+		StoredPayload& oldest = m_payloads.at(m_kept.front().key)[m_kept.front().index];
+		m_kept_bytes -= oldest.bytes.size();
+		std::vector<unsigned char>().swap(oldest.bytes);
+		oldest.kept = false;
+		m_kept.pop_front();
+	}
+	std::vector<StoredPayload>& candidates = m_payloads.at(key);
+	const unsigned char* bytes = (const unsigned char*)data;
+	candidates.back().bytes.assign(bytes, bytes + size);
+	candidates.back().kept = true;
+	m_kept_bytes += size;
+	m_kept.push_back(KeptPayload{key, candidates.size() - 1});
+}
+
+/* Put the data into the trace unless the same bytes already are there. Returns the id to refer to it by, 0 if there is no data.
+ * m_mutex must be held. */
+uint64_t TraceWriter::payload(const void* data, size_t size){
+	if(data == nullptr)
+		return 0;
+	PayloadKey key = {m_hash(data, size), size};
+	std::vector<StoredPayload>& candidates = m_payloads[key];
+	for(const StoredPayload& stored : candidates)
+		if(stored.kept && (size == 0 || memcmp(stored.bytes.data(), data, size) == 0))
+			return stored.id;
+
+	/* New content, or content which was forgotten. The id is the hash unless another payload already took it, then the next free one. */
+	uint64_t id = key.hash;
+	while(id == 0 || !m_payload_ids.insert(id).second)
+		id++;
+	candidates.push_back(StoredPayload{id, std::vector<unsigned char>(), false});
+	keep(key, data, size);
+
+	static const unsigned char padding[4] = {0, 0, 0, 0};
+	uint32_t words[4] = {bu_glw_trace_low(id), bu_glw_trace_high(id), bu_glw_trace_low(size), bu_glw_trace_high(size)};
+	TraceRecordHeader header = {BU_GLW_TRACE_PAYLOAD, 4};
+	append(&header, sizeof(header));
+	append(words, sizeof(words));
+	append(data, size);
+	append(padding, (4 - size % 4) % 4);
+	return id;
+}
+
+void TraceWriter::begin(const char* path){
+	std::lock_guard<std::mutex> control(m_control);
+	stop();
+
+	FILE* file = fopen(path, "wb");
+	if(file == NULL){
+		fprintf(stderr, "Could not open %s to write the trace into.\n", path);
+		throw( BuGlwIOError() );
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_file = file;
+	m_stopping = false;
+	m_failed = false;
+	m_chunk.clear();
+	m_chunk.reserve(BU_GLW_TRACE_CHUNK_SIZE);
+	TraceFileHeader header;
+	memcpy(header.magic, BU_GLW_TRACE_MAGIC, sizeof(header.magic));
+	header.version = BU_GLW_TRACE_VERSION;
+	append(&header, sizeof(header));
+	m_writer = std::thread(&TraceWriter::writeLoop, this);
+	m_enabled.store(true);
+}
+
+void TraceWriter::end(){
+	std::lock_guard<std::mutex> control(m_control);
+	stop();
+}
+
+/* m_control must be held. */
+void TraceWriter::stop(){
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!m_enabled.load())
+			return;
+		/* Under the lock, so no record is left halfway when the chunk goes. */
+		m_enabled.store(false);
+		handOff();
+		m_stopping = true;
+	}
+	m_ready.notify_one();
+	m_writer.join();
+
+	bool failed = m_failed || fclose(m_file) != 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_file = NULL;
+		m_payloads.clear();
+		m_payload_ids.clear();
+		m_kept.clear();
+		m_kept_bytes = 0;
+		m_spare.clear();
+	}
+	if(failed){
+		fprintf(stderr, "Writing the trace failed.\n");
+		throw( BuGlwIOError() );
+	}
+}
+
+void TraceWriter::record(TraceOpcode opcode, const uint32_t* words, unsigned int count){
+	if(!enabled())
+		return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_enabled.load(std::memory_order_relaxed))
+		return; /* Ended while waiting for the lock. */
+	TraceRecordHeader header = {(uint16_t)opcode, (uint16_t)count};
+	append(&header, sizeof(header));
+	append(words, count * sizeof(uint32_t));
+	if(m_chunk.size() >= BU_GLW_TRACE_CHUNK_SIZE)
+		handOff();
+}
+
+void TraceWriter::record(TraceOpcode opcode, uint32_t* words, unsigned int count, unsigned int at, const void* data, size_t size){
+	if(!enabled())
+		return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_enabled.load(std::memory_order_relaxed))
+		return;
+	uint64_t id = payload(data, size);
+	words[at] = bu_glw_trace_low(id);
+	words[at + 1] = bu_glw_trace_high(id);
+	TraceRecordHeader header = {(uint16_t)opcode, (uint16_t)count};
+	append(&header, sizeof(header));
+	append(words, count * sizeof(uint32_t));
+	if(m_chunk.size() >= BU_GLW_TRACE_CHUNK_SIZE)
+		handOff();
+}
+
+void TraceWriter::frame(){
+	if(!enabled())
+		return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_enabled.load(std::memory_order_relaxed))
+		return;
+	TraceRecordHeader header = {BU_GLW_TRACE_FRAME, 0};
+	append(&header, sizeof(header));
+	handOff();
+}
+
+/******************************* Reading ********************************/
+
+bool bu_glw_trace_parse(const unsigned char* data, size_t size, TraceContents& contents){
+	TraceFileHeader header;
+	if(size < sizeof(header)){
+		fprintf(stderr, "The trace is too short.\n");
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if(memcmp(header.magic, BU_GLW_TRACE_MAGIC, 4) != 0 || header.version != BU_GLW_TRACE_VERSION){
+		fprintf(stderr, "Not a bu_glw trace of version %d.\n", BU_GLW_TRACE_VERSION);
+		return false;
+	}
+
+	size_t offset = sizeof(header);
+	while(offset + sizeof(TraceRecordHeader) <= size){
+		TraceRecordHeader record_header;
+		memcpy(&record_header, data + offset, sizeof(record_header));
+		offset += sizeof(record_header);
+		size_t words_size = record_header.words * sizeof(uint32_t);
+		if(offset + words_size > size){
+			fprintf(stderr, "The trace ends within a record, it was probably cut short. Using what is there.\n");
+			break;
+		}
+		if(bu_glw_trace_opcode_words(record_header.opcode) == 0 && record_header.opcode != BU_GLW_TRACE_FRAME){
+			fprintf(stderr, "Unknown opcode %u at byte %zu.\n", record_header.opcode, offset - sizeof(record_header));
+			return false;
+		}
+		if(record_header.words < bu_glw_trace_opcode_words(record_header.opcode)){
+			fprintf(stderr, "A %s record at byte %zu is too short.\n", bu_glw_trace_opcode_name(record_header.opcode), offset - sizeof(record_header));
+			return false;
+		}
+		/* Everything in a trace is 4 byte aligned. */
+		const uint32_t* words = (const uint32_t*)(data + offset);
+		offset += words_size;
+
+		if(record_header.opcode == BU_GLW_TRACE_PAYLOAD){
+			TracePayload payload = {data + offset, bu_glw_trace_join(words[2], words[3])};
+			if(payload.size > size - offset){
+				fprintf(stderr, "The trace ends within a payload, it was probably cut short. Using what is there.\n");
+				break;
+			}
+			contents.payloads[ bu_glw_trace_join(words[0], words[1]) ] = payload;
+			offset += (size_t)((payload.size + 3) / 4 * 4);
+			continue;
+		}
+		if(record_header.opcode == BU_GLW_TRACE_FRAME){
+			contents.frame_ends.push_back(contents.records.size());
+			continue;
+		}
+		contents.records.push_back(TraceRecord{words, record_header.opcode, record_header.words});
+	}
+	/* Whatever came after the last frame marker, e.g. when the trace was ended mid-frame. */
+	if(contents.frame_ends.empty() ? !contents.records.empty() : contents.frame_ends.back() != contents.records.size())
+		contents.frame_ends.push_back(contents.records.size());
+	return true;
+}
@@ -0,0 +1,48 @@
+/* Test helpers for Benoe's Utilities: OpenGL wrappers
+ *
+ * Every test is a small program checking one module, which returns 0 if all its checks
+ * passed. Failed checks are printed with their location and do not stop the test.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_TEST_HEADER
+#define BU_GLW_TEST_HEADER
+
+#include <stdio.h>
+
+/* Returned by tests which can not run here, e.g. for lack of an OpenGL context. ctest reports them as skipped. */
+#define BU_GLW_TEST_SKIPPED 77
+
+static int bu_glw_test_failures = 0;
+
+#define BU_GLW_CHECK(condition) \
+	do{ \
+		if( !(condition) ){ \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			bu_glw_test_failures++; \
+		} \
+	}while(0)
+
+/* Check that the statement throws the given exception type. */
+#define BU_GLW_CHECK_THROWS(statement, exception) \
+	do{ \
+		bool bu_glw_thrown = false; \
+		try{ statement; }catch(exception&){ bu_glw_thrown = true; } \
+		if( !bu_glw_thrown ){ \
+			fprintf(stderr, "%s:%d: %s did not throw %s\n", __FILE__, __LINE__, #statement, #exception); \
+			bu_glw_test_failures++; \
+		} \
+	}while(0)
+
+/* The exit code of the test. */
+static inline int bu_glw_test_result(){
+	if(bu_glw_test_failures != 0){
+		fprintf(stderr, "%d checks failed.\n", bu_glw_test_failures);
+		return 1;
+	}
+	return 0;
+}
+
+#endif
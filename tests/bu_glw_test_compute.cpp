@@ -0,0 +1,165 @@
+/* Tests of the compute path: dispatching a ComputeProgram over an SSBO, directly, indirectly and over part of the buffer,
+ * and reading the results back.
+ *
+ * Runs in a headless context, so Mesa's llvmpipe is enough. Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_test.hpp"
+#include <string.h>
+
+/* Not a multiple of the local size, so the last group is only partly used. */
+#define COUNT 1000
+
+static const GLchar* source =
+	"#version 430 core\n"
+	"layout(local_size_x = 64) in;\n"
+	"layout(std430, binding = 3) buffer Values{ uint values[]; };\n"
+	"uniform uint count;\n"
+	"void main(){\n"
+	"	uint i = gl_GlobalInvocationID.x;\n"
+	"	if(i >= count) return;\n"
+	"	values[i] = values[i] * 2u + i;\n"
+	"}\n";
+
+static GLuint results[COUNT + 1];
+
+static void read_results(void* buffer){
+	memcpy(results, buffer, sizeof(results));
+}
+
+static void test_dispatch_and_readback(){
+	ComputeShader shader(nullptr);
+	shader.compile(1, &source, NULL);
+	ComputeProgram program(shader);
+	BU_GLW_CHECK(program.m_local_size[0] == 64);
+	BU_GLW_CHECK(program.m_local_size[1] == 1 && program.m_local_size[2] == 1);
+
+	/* One value past the end, which the shader must not touch. */
+	GLuint values[COUNT + 1];
+	for(GLuint i = 0; i < COUNT + 1; ++i)
+		values[i] = i;
+	SSBO ssbo(values, sizeof(values));
+	ssbo.bind_base(3);
+
+	glProgramUniform1ui(program.m_ID, program.getUniformLocation("count"), COUNT);
+	program.dispatchInvocations(COUNT);
+	bu_glw_memory_barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	ssbo.map(read_results, GL_READ_ONLY);
+
+	bool all_written = true;
+	for(GLuint i = 0; i < COUNT; ++i)
+		all_written = all_written && results[i] == i * 3;
+	BU_GLW_CHECK(all_written);
+	BU_GLW_CHECK(results[COUNT] == COUNT);
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+}
+
+static void reset_values(SSBO& ssbo){
+	GLuint values[COUNT + 1];
+	for(GLuint i = 0; i < COUNT + 1; ++i)
+		values[i] = i;
+	ssbo.partial_data(0, values, sizeof(values));
+}
+
+static void test_dispatch_indirect(){
+	ComputeShader shader(nullptr);
+	shader.compile(1, &source, NULL);
+	ComputeProgram program(shader);
+	SSBO ssbo(NULL, (COUNT + 1) * sizeof(GLuint));
+	reset_values(ssbo);
+	ssbo.bind_base(3);
+	glProgramUniform1ui(program.m_ID, program.getUniformLocation("count"), COUNT);
+
+	/* One word in front, so the group counts are read from an offset. */
+	GLuint groups = (COUNT + 63) / 64;
+	GLuint command[4] = {0xffffffff, groups, 1, 1};
+	SSBO indirect(command, sizeof(command));
+	program.dispatchIndirect(indirect, sizeof(GLuint));
+	bu_glw_memory_barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	ssbo.map(read_results, GL_READ_ONLY);
+
+	bool all_written = true;
+	for(GLuint i = 0; i < COUNT; ++i)
+		all_written = all_written && results[i] == i * 3;
+	BU_GLW_CHECK(all_written);
+	BU_GLW_CHECK(results[COUNT] == COUNT);
+
+	/* Without a buffer argument, the one still bound is used: a single group this time. */
+	GLuint one_group[3] = {1, 1, 1};
+	indirect.partial_data(0, one_group, sizeof(one_group));
+	reset_values(ssbo);
+	program.dispatchIndirect();
+	bu_glw_memory_barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	ssbo.map(read_results, GL_READ_ONLY);
+	BU_GLW_CHECK(results[63] == 63 * 3);
+	BU_GLW_CHECK(results[64] == 64);
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+}
+
+static void test_bind_range(){
+	ComputeShader shader(nullptr);
+	shader.compile(1, &source, NULL);
+	ComputeProgram program(shader);
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	BU_GLW_CHECK(alignment > 0 && alignment % sizeof(GLuint) == 0);
+	if(alignment <= 0 || alignment % sizeof(GLuint) != 0)
+		return;
+	/* Only the second half is bound, so the shader sees it starting at values[0]. */
+	GLuint half = (GLuint)(alignment / sizeof(GLuint)) * ((COUNT / 2 + alignment / sizeof(GLuint) - 1) / (alignment / sizeof(GLuint)));
+	SSBO ssbo(NULL, (COUNT + 1) * sizeof(GLuint));
+	reset_values(ssbo);
+	ssbo.bind_range(3, half * sizeof(GLuint), (COUNT + 1 - half) * sizeof(GLuint));
+	glProgramUniform1ui(program.m_ID, program.getUniformLocation("count"), COUNT - half);
+	program.dispatchInvocations(COUNT - half);
+	bu_glw_memory_barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	ssbo.map(read_results, GL_READ_ONLY);
+
+	bool front_untouched = true;
+	for(GLuint i = 0; i < half; ++i)
+		front_untouched = front_untouched && results[i] == i;
+	BU_GLW_CHECK(front_untouched);
+	bool back_written = true;
+	for(GLuint i = half; i < COUNT; ++i)
+		back_written = back_written && results[i] == i * 2 + (i - half);
+	BU_GLW_CHECK(back_written);
+	BU_GLW_CHECK(results[COUNT] == COUNT);
+
+#if !BU_GLW_NO_BOUNDS_CHECKING
+	GLsizeiptr size = ssbo.size();
+	BU_GLW_CHECK_THROWS(ssbo.bind_range(3, 0, size + 1), BuGlwOutOfBounds);
+	BU_GLW_CHECK_THROWS(ssbo.bind_range(3, alignment, size), BuGlwOutOfBounds);
+	BU_GLW_CHECK_THROWS(ssbo.bind_range(3, -alignment, 4), BuGlwOutOfBounds);
+	BU_GLW_CHECK_THROWS(ssbo.bind_range(3, 0, 0), BuGlwOutOfBounds);
+#endif
+	/* The whole buffer is a valid range. */
+	ssbo.bind_range(3, 0, ssbo.size());
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+}
+
+static void test_failed_link(){
+	/* Compiles, but a compute program without main does not link. */
+	ComputeShader shader(nullptr);
+	const GLchar* no_main = "#version 430 core\nlayout(local_size_x = 1) in;\nvoid helper(){}\n";
+	shader.compile(1, &no_main, NULL);
+	BU_GLW_CHECK_THROWS(ComputeProgram program(shader), GLShaderProgramLinkingFailed);
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	test_dispatch_and_readback();
+	test_dispatch_indirect();
+	test_bind_range();
+	test_failed_link();
+	return bu_glw_test_result();
+}
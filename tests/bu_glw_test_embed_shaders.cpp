@@ -0,0 +1,94 @@
+/* Tests of shaders embedded with the bu_glw_embed_shaders() CMake function: the data must match the files and link into a working program.
+ *
+ * tests/data/fullscreen.vert and tests/data/blue.frag are embedded as test_shaders.hpp. The expected hashes come from CMake as
+ * BU_GLW_TEST_VERT_HASH and BU_GLW_TEST_FRAG_HASH.
+ * Draws into an offscreen framebuffer in a headless context, so Mesa's llvmpipe is enough.
+ * Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_test.hpp"
+#include "test_shaders.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static std::vector<unsigned char> read_file(const char* path){
+	std::vector<unsigned char> bytes;
+	FILE* file = fopen(path, "rb");
+	if(file == NULL)
+		return bytes;
+	unsigned char buffer[4096];
+	size_t read;
+	while( (read = fread(buffer, 1, sizeof(buffer), file)) != 0 )
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+	return bytes;
+}
+
+static bool ends_with(const char* text, const char* end){
+	size_t text_length = strlen(text), end_length = strlen(end);
+	return text_length >= end_length && strcmp(text + text_length - end_length, end) == 0;
+}
+
+/* The embedded bytes are the file's, its path is where it was embedded from. */
+static void check_embedded(const EmbeddedShader& shader, const char* file_name, uint64_t hash){
+	BU_GLW_CHECK(ends_with(shader.path, file_name));
+	std::vector<unsigned char> file = read_file(shader.path);
+	BU_GLW_CHECK(!file.empty());
+	BU_GLW_CHECK(shader.length == (GLint)file.size());
+	BU_GLW_CHECK(memcmp(shader.data, file.data(), file.size()) == 0);
+	BU_GLW_CHECK(shader.data[shader.length] == 0);
+	BU_GLW_CHECK(strlen((const char*)shader.data) == (size_t)shader.length);
+	BU_GLW_CHECK(shader.hash == hash);
+}
+
+static void test_contents(){
+	check_embedded(test_shaders_fullscreen_vert, "/tests/data/fullscreen.vert", BU_GLW_TEST_VERT_HASH);
+	check_embedded(test_shaders_blue_frag, "/tests/data/blue.frag", BU_GLW_TEST_FRAG_HASH);
+	BU_GLW_CHECK(test_shaders_fullscreen_vert.hash != test_shaders_blue_frag.hash);
+}
+
+static void test_link_and_draw(){
+	ShaderProgram program(test_shaders_fullscreen_vert, test_shaders_blue_frag);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program.m_ID, GL_LINK_STATUS, &linked);
+	BU_GLW_CHECK(linked == GL_TRUE);
+
+	glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	program.use();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	GLubyte pixel[4] = {0, 0, 0, 0};
+	glReadPixels(4, 4, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	BU_GLW_CHECK(pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 255);
+}
+
+int main(){
+	test_contents();
+
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	RenderTarget color(RenderTargetDesc{16, 16, GL_RGBA8, 0, false});
+	Framebuffer framebuffer;
+	framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.validate();
+	framebuffer.bind();
+	glViewport(0, 0, 16, 16);
+
+	/* The core profile needs a vertex array bound to draw, even without attributes. */
+	VAO vao;
+	vao.bind();
+
+	test_link_and_draw();
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
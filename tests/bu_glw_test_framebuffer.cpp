@@ -0,0 +1,88 @@
+/* Tests of the render target pool: sharing between passes, reuse across frames and invalidation.
+ *
+ * Runs in a headless context, so Mesa's llvmpipe is enough. Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_test.hpp"
+
+static const RenderTargetDesc color_desc = {64, 32, GL_RGBA8, 0, true};
+static const RenderTargetDesc depth_desc = {64, 32, GL_DEPTH24_STENCIL8, 0, false};
+
+static void test_sharing(){
+	RenderTargetPool pool;
+	/* Passes 0-1 and 2-3 do not overlap and share, 1-2 overlaps both. */
+	const RenderTarget& a = pool.acquire(color_desc, 0, 1);
+	const RenderTarget& b = pool.acquire(color_desc, 2, 3);
+	const RenderTarget& c = pool.acquire(color_desc, 1, 2);
+	BU_GLW_CHECK(&a == &b);
+	BU_GLW_CHECK(&a != &c);
+
+	RenderTargetPoolStats stats = pool.stats();
+	BU_GLW_CHECK(stats.targets == 2);
+	BU_GLW_CHECK(stats.allocations == 2);
+	BU_GLW_CHECK(stats.reuses == 1);
+	BU_GLW_CHECK(stats.memory == 2 * 64 * 32 * 4);
+}
+
+static void test_frames(){
+	RenderTargetPool pool(1);
+	const RenderTarget* first = &pool.acquire(depth_desc);
+	pool.endFrame();
+	BU_GLW_CHECK(pool.stats().targets_in_use == 0);
+
+	/* The same target comes back in the next frame. */
+	BU_GLW_CHECK(&pool.acquire(depth_desc) == first);
+	BU_GLW_CHECK(pool.stats().allocations == 1);
+	pool.endFrame();
+
+	/* Unused for longer than max_idle_frames, it is freed. */
+	pool.endFrame();
+	pool.endFrame();
+	pool.endFrame();
+	BU_GLW_CHECK(pool.stats().targets == 0);
+	BU_GLW_CHECK(pool.stats().memory == 0);
+}
+
+static void test_invalidation_keeps_state(){
+	/* Invalidating renderbuffers goes through a framebuffer of the pool, the application's binding must survive it. */
+	RenderTarget color(RenderTargetDesc{64, 32, GL_RGBA8, 0, false});
+	Framebuffer framebuffer;
+	framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.bind();
+
+	RenderTargetPool pool;
+	for(int frame = 0; frame < 3; ++frame){
+		pool.acquire(depth_desc, 0, 0);
+		pool.acquire(depth_desc, 1, 1);
+		pool.acquire(color_desc, 0, 0);
+		pool.acquire(color_desc, 1, 1);
+		pool.endFrame();
+	}
+
+	GLint bound = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+	BU_GLW_CHECK((GLuint)bound == framebuffer.id());
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &bound);
+	BU_GLW_CHECK((GLuint)bound == framebuffer.id());
+	BU_GLW_CHECK(pool.stats().targets == 2);
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	framebuffer.unbind();
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	test_sharing();
+	test_frames();
+	test_invalidation_keeps_state();
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
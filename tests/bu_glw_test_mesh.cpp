@@ -0,0 +1,146 @@
+/* Tests of the checks done on binary mesh files before anything is uploaded.
+ *
+ * The files are built in memory. Validation only reads them, so no context is needed.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_mesh.hpp"
+#include "bu_glw_test.hpp"
+#include <string.h>
+#include <vector>
+
+/* A triangle with positions only and one meshlet, laid out like bu_glw_meshconv writes it. */
+static std::vector<unsigned char> make_file(){
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BU_GLW_MESH_MAGIC, 4);
+	header.version = BU_GLW_MESH_VERSION;
+	header.attribute_count = 1;
+	header.attributes[0] = MeshFileAttribute{3, BU_GLW_MESH_FLOAT, sizeof(float), 0};
+	header.vertex_stride = 3 * sizeof(float);
+	header.index_type = BU_GLW_MESH_UNSIGNED_INT;
+	header.vertex_count = 3;
+	header.index_count = 3;
+	header.meshlet_count = 1;
+	header.vertex_offset = bu_glw_mesh_align(sizeof(MeshFileHeader));
+	header.index_offset = bu_glw_mesh_align(header.vertex_offset + header.vertex_count * header.vertex_stride);
+	header.meshlet_offset = bu_glw_mesh_align(header.index_offset + header.index_count * sizeof(uint32_t));
+
+	std::vector<unsigned char> file(header.meshlet_offset + sizeof(MeshFileMeshlet), 0);
+	memcpy(file.data(), &header, sizeof(header));
+	MeshFileMeshlet meshlet = {0, 3, {0.0f, 0.0f, 0.0f}, 1.0f};
+	memcpy(file.data() + header.meshlet_offset, &meshlet, sizeof(meshlet));
+	return file;
+}
+
+static MeshFileHeader* header_of(std::vector<unsigned char>& file){
+	return (MeshFileHeader*)file.data();
+}
+
+static void test_valid(){
+	std::vector<unsigned char> file = make_file();
+	BU_GLW_CHECK(bu_glw_mesh_validate(file.data(), file.size()) == header_of(file));
+}
+
+static void test_truncated(){
+	std::vector<unsigned char> file = make_file();
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size() - 1), BuGlwBadMeshFile);
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), sizeof(MeshFileHeader) - 1), BuGlwBadMeshFile);
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(nullptr, file.size()), BuGlwBadMeshFile);
+}
+
+static void test_misaligned(){
+	std::vector<unsigned char> file = make_file();
+	header_of(file)->vertex_offset += 4;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	file = make_file();
+	header_of(file)->index_offset -= 4;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	file = make_file();
+	header_of(file)->meshlet_offset -= sizeof(MeshFileMeshlet);
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+}
+
+static void test_overflow(){
+	/* count * stride wraps around to a small number. */
+	std::vector<unsigned char> file = make_file();
+	header_of(file)->index_count = (UINT64_MAX / sizeof(uint32_t)) + 2;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	/* offset + bytes wraps around. */
+	file = make_file();
+	header_of(file)->vertex_offset = UINT64_MAX - (BU_GLW_MESH_ALIGNMENT - 1);
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+}
+
+static void test_counts_fit_glsizei(){
+	/* Even if the file were large enough, Mesh could not draw this many. */
+	std::vector<unsigned char> file = make_file();
+	header_of(file)->vertex_count = (uint64_t)INT32_MAX + 1;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), SIZE_MAX), BuGlwBadMeshFile);
+
+	file = make_file();
+	header_of(file)->index_count = (uint64_t)INT32_MAX + 1;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), SIZE_MAX), BuGlwBadMeshFile);
+}
+
+static void test_bad_attributes(){
+	/* More fields than glVertexAttribPointer takes, with a stride to match. */
+	std::vector<unsigned char> file = make_file();
+	header_of(file)->attributes[0].num_fields = 5;
+	header_of(file)->vertex_stride = 5 * sizeof(float);
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	file = make_file();
+	header_of(file)->attributes[0].field_type = 0x1234;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	/* Sizes that do not match the type, even when the stride does. */
+	file = make_file();
+	header_of(file)->attributes[0].field_size = 2;
+	header_of(file)->vertex_stride = 3 * 2;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	file = make_file();
+	header_of(file)->attributes[0] = MeshFileAttribute{3, BU_GLW_MESH_DOUBLE, sizeof(float), 0};
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	/* Other types are fine with their own size. */
+	file = make_file();
+	header_of(file)->attributes[0] = MeshFileAttribute{4, BU_GLW_MESH_UNSIGNED_SHORT, 2, 1};
+	header_of(file)->vertex_stride = 4 * 2;
+	BU_GLW_CHECK(bu_glw_mesh_validate(file.data(), file.size()) == header_of(file));
+}
+
+static void test_bad_header(){
+	std::vector<unsigned char> file = make_file();
+	header_of(file)->vertex_stride = 16;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	file = make_file();
+	header_of(file)->attributes[0].num_fields = 0;
+	header_of(file)->vertex_stride = 0;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+
+	/* The meshlet reaches past the indices. */
+	file = make_file();
+	MeshFileMeshlet* meshlet = (MeshFileMeshlet*)(file.data() + header_of(file)->meshlet_offset);
+	meshlet->index_offset = 1;
+	BU_GLW_CHECK_THROWS(bu_glw_mesh_validate(file.data(), file.size()), BuGlwBadMeshFile);
+}
+
+int main(){
+	test_valid();
+	test_truncated();
+	test_misaligned();
+	test_overflow();
+	test_counts_fit_glsizei();
+	test_bad_header();
+	test_bad_attributes();
+	return bu_glw_test_result();
+}
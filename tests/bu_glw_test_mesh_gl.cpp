@@ -0,0 +1,151 @@
+/* Tests of loading a mesh written by bu_glw_meshconv: the buffers must hold the blobs of the file and the VAO must describe its attributes.
+ *
+ * The mesh is converted from tests/data/bu_glw_test_mesh.obj at build time, BU_GLW_TEST_MESH_PATH is where it ends up.
+ * Draws into an offscreen framebuffer in a headless context, so Mesa's llvmpipe is enough.
+ * Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_mesh.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_test.hpp"
+#include <string.h>
+#include <vector>
+
+#ifndef BU_GLW_TEST_MESH_PATH
+#define BU_GLW_TEST_MESH_PATH "bu_glw_test_mesh.bumf"
+#endif
+
+/* A quad with positions, texcoords and a normal, merged into 4 vertices of 8 floats. */
+#define STRIDE (8 * sizeof(float))
+
+static const char* vertex_source =
+	"#version 430 core\n"
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 1) in vec2 texcoord;\n"
+	"layout(location = 2) in vec3 normal;\n"
+	"out vec4 attributes;\n"
+	"void main(){\n"
+	"	attributes = vec4(texcoord, normal.z, 1.0);\n"
+	"	gl_Position = vec4(position, 1.0);\n"
+	"}\n";
+static const char* fragment_source =
+	"#version 430 core\n"
+	"in vec4 attributes;\n"
+	"out vec4 color;\n"
+	"void main(){\n"
+	"	color = attributes;\n"
+	"}\n";
+
+static GLint buffer_size(GLuint buffer){
+	GLint size = 0;
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+	return size;
+}
+
+static bool buffer_holds(GLuint buffer, const unsigned char* data, size_t size){
+	std::vector<unsigned char> contents(size);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)size, contents.data());
+	return memcmp(contents.data(), data, size) == 0;
+}
+
+static GLint attribute(GLuint index, GLenum parameter){
+	GLint value = -1;
+	glGetVertexAttribiv(index, parameter, &value);
+	return value;
+}
+
+static void check_attribute(GLuint index, GLint fields, size_t offset, GLuint vbo){
+	BU_GLW_CHECK(attribute(index, GL_VERTEX_ATTRIB_ARRAY_ENABLED) == GL_TRUE);
+	BU_GLW_CHECK(attribute(index, GL_VERTEX_ATTRIB_ARRAY_SIZE) == fields);
+	BU_GLW_CHECK(attribute(index, GL_VERTEX_ATTRIB_ARRAY_TYPE) == GL_FLOAT);
+	BU_GLW_CHECK(attribute(index, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED) == GL_FALSE);
+	BU_GLW_CHECK(attribute(index, GL_VERTEX_ATTRIB_ARRAY_STRIDE) == (GLint)STRIDE);
+	BU_GLW_CHECK(attribute(index, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING) == (GLint)vbo);
+	void* pointer = nullptr;
+	glGetVertexAttribPointerv(index, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+	BU_GLW_CHECK((size_t)pointer == offset);
+}
+
+static void test_buffers_and_attributes(){
+	MappedFile file(BU_GLW_TEST_MESH_PATH);
+	const MeshFileHeader* header = bu_glw_mesh_validate(file.data(), file.size());
+	BU_GLW_CHECK(header->attribute_count == 3 && header->vertex_stride == STRIDE);
+
+	Mesh mesh(file);
+	BU_GLW_CHECK(mesh.vertexCount() == 4);
+	BU_GLW_CHECK(mesh.indexCount() == 6);
+	BU_GLW_CHECK(mesh.meshlets().size() == 1);
+	if(mesh.meshlets().size() == 1)
+		BU_GLW_CHECK(mesh.meshlets()[0].index_offset == 0 && mesh.meshlets()[0].index_count == 6);
+
+	/* The buffers are only reachable through the VAO, which records both. */
+	mesh.bind();
+	GLint ebo = 0;
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &ebo);
+	GLuint vbo = (GLuint)attribute(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING);
+	BU_GLW_CHECK(ebo != 0 && vbo != 0 && (GLuint)ebo != vbo);
+
+	BU_GLW_CHECK(buffer_size(vbo) == 4 * (GLint)STRIDE);
+	BU_GLW_CHECK(buffer_size(ebo) == 6 * (GLint)sizeof(uint32_t));
+	BU_GLW_CHECK(buffer_holds(vbo, file.data() + header->vertex_offset, 4 * STRIDE));
+	BU_GLW_CHECK(buffer_holds(ebo, file.data() + header->index_offset, 6 * sizeof(uint32_t)));
+
+	check_attribute(0, 3, 0, vbo);
+	check_attribute(1, 2, 3 * sizeof(float), vbo);
+	check_attribute(2, 3, 5 * sizeof(float), vbo);
+	BU_GLW_CHECK(attribute(3, GL_VERTEX_ATTRIB_ARRAY_ENABLED) == GL_FALSE);
+}
+
+/* Texcoords go to red and green and the normal to blue, so a pixel shows every attribute arrived. */
+static void check_pixel(){
+	GLubyte pixel[4] = {0, 0, 0, 0};
+	glReadPixels(4, 4, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	/* The texcoord at the centre of pixel 4 of 16 is 4.5 / 16, about 72 out of 255. */
+	BU_GLW_CHECK(pixel[0] >= 70 && pixel[0] <= 74);
+	BU_GLW_CHECK(pixel[1] == pixel[0]);
+	BU_GLW_CHECK(pixel[2] == 255);
+}
+
+static void test_draw(){
+	VertexShader vs(nullptr);
+	vs.compile(1, &vertex_source, NULL);
+	FragmentShader fs(nullptr);
+	fs.compile(1, &fragment_source, NULL);
+	ShaderProgram program(vs, fs);
+	program.use();
+
+	Mesh mesh(BU_GLW_TEST_MESH_PATH);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	mesh.draw();
+	check_pixel();
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	mesh.drawMeshlet(0);
+	check_pixel();
+	BU_GLW_CHECK_THROWS(mesh.drawMeshlet(1), BuGlwOutOfBounds);
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	RenderTarget color(RenderTargetDesc{16, 16, GL_RGBA8, 0, false});
+	Framebuffer framebuffer;
+	framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.validate();
+	framebuffer.bind();
+	glViewport(0, 0, 16, 16);
+
+	test_buffers_and_attributes();
+	test_draw();
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
@@ -0,0 +1,101 @@
+/* Tests of how shader permutations find the #version line and inject their defines after it.
+ *
+ * Splitting and building the strings only look at the text, so no context is needed.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_permutations.hpp"
+#include "bu_glw_test.hpp"
+#include <string.h>
+#include <string>
+#include <vector>
+
+/* The length of the version part of the source, -1 if it was not found. */
+static GLint version_length(const char* source){
+	PermutationSource split;
+	split.split(source);
+	return split.version_length == 0 ? -1 : split.version_length;
+}
+
+static void test_plain(){
+	const char* source = "#version 430 core\nvoid main(){}\n";
+	BU_GLW_CHECK(version_length(source) == (GLint)strlen("#version 430 core\n"));
+
+	PermutationSource split;
+	split.split(source);
+	BU_GLW_CHECK(strcmp(split.line_directive, "#line 2\n") == 0);
+
+	BU_GLW_CHECK(version_length("void main(){}\n") == -1);
+	/* Without a trailing newline all of it is the version part. */
+	BU_GLW_CHECK(version_length("#version 430") == (GLint)strlen("#version 430"));
+}
+
+static void test_comments(){
+	/* In comments it is not a directive. */
+	const char* line_comment = "// needs #version 430\n#version 450 core\nvoid main(){}\n";
+	BU_GLW_CHECK(version_length(line_comment) == (GLint)strlen("// needs #version 430\n#version 450 core\n"));
+
+	const char* block_comment = "/*\n#version 330\n*/\n#version 450 core\nvoid main(){}\n";
+	BU_GLW_CHECK(version_length(block_comment) == (GLint)strlen("/*\n#version 330\n*/\n#version 450 core\n"));
+
+	PermutationSource split;
+	split.split(block_comment);
+	BU_GLW_CHECK(strcmp(split.line_directive, "#line 5\n") == 0);
+
+	BU_GLW_CHECK(version_length("/* #version 430 */\nvoid main(){}\n") == -1);
+	BU_GLW_CHECK(version_length("/* unterminated\n#version 430\n") == -1);
+
+	/* Comments are whitespace to the preprocessor, so the directive may follow one. */
+	const char* after_comment = "/* header */ #version 430\nvoid main(){}\n";
+	BU_GLW_CHECK(version_length(after_comment) == (GLint)strlen("/* header */ #version 430\n"));
+}
+
+static void test_not_first_token(){
+	BU_GLW_CHECK(version_length("int a; #version 430\n") == -1);
+	BU_GLW_CHECK(version_length("#define V #version\nvoid main(){}\n") == -1);
+	BU_GLW_CHECK(version_length("#versions 430\n") == -1);
+
+	/* Indented or with whitespace after the # it still is one. */
+	BU_GLW_CHECK(version_length("  \t# version 430\n") == (GLint)strlen("  \t# version 430\n"));
+}
+
+/* The strings for the mask, joined the way the compiler sees them. */
+static std::string joined(const char* source, const std::vector<std::string>& defines, uint64_t mask){
+	PermutationSource split;
+	split.split(source);
+	const GLchar* strings[BU_GLW_MAX_PERMUTATION_STRINGS];
+	GLint lengths[BU_GLW_MAX_PERMUTATION_STRINGS];
+	GLsizei count = split.strings(defines, mask, strings, lengths);
+	std::string text;
+	for(GLsizei i = 0; i < count; ++i){
+		if(lengths[i] < 0)
+			text.append(strings[i]);
+		else
+			text.append(strings[i], lengths[i]);
+	}
+	return text;
+}
+
+static void test_strings(){
+	std::vector<std::string> defines;
+	defines.push_back("#define A 1\n");
+	defines.push_back("#define B 1\n");
+
+	BU_GLW_CHECK(joined("#version 430\nvoid main(){}\n", defines, 2) == "#version 430\n#define B 1\n#line 2\nvoid main(){}\n");
+	BU_GLW_CHECK(joined("#version 430\nvoid main(){}\n", defines, 0) == "#version 430\n#line 2\nvoid main(){}\n");
+	/* Without #version the defines go first. */
+	BU_GLW_CHECK(joined("void main(){}\n", defines, 3) == "#define A 1\n#define B 1\n#line 1\nvoid main(){}\n");
+	/* The #version line ends the source: the defines still need a line of their own. */
+	BU_GLW_CHECK(joined("#version 450", defines, 1) == "#version 450\n#define A 1\n#line 1\n");
+}
+
+int main(){
+	test_plain();
+	test_comments();
+	test_not_first_token();
+	test_strings();
+	return bu_glw_test_result();
+}
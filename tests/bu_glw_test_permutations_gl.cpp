@@ -0,0 +1,144 @@
+/* Tests of compiling shader permutations: the defines of a mask must reach the shaders, and every variant is compiled once.
+ *
+ * Draws into an offscreen framebuffer in a headless context, so Mesa's llvmpipe is enough.
+ * Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_permutations.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_test.hpp"
+#include <stdio.h>
+
+/* A triangle covering the whole viewport, without any vertex buffer. */
+static const char* vertex_source =
+	"#version 430 core\n"
+	"void main(){\n"
+	"	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+/* Every feature turns one channel on. */
+static const char* fragment_source =
+	"#version 430 core\n"
+	"out vec4 color;\n"
+	"void main(){\n"
+	"	color = vec4(0.0, 0.0, 0.0, 1.0);\n"
+	"#ifdef RED\n"
+	"	color.r = 1.0;\n"
+	"#endif\n"
+	"#ifdef GREEN\n"
+	"	color.g = 1.0;\n"
+	"#endif\n"
+	"#ifdef BLUE\n"
+	"	color.b = 1.0;\n"
+	"#endif\n"
+	"}\n";
+static const char* const features[3] = {"RED", "GREEN", "BLUE"};
+
+static void draw_and_check(ShaderProgram& program, uint64_t mask){
+	glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	program.use();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	GLubyte pixel[4] = {0, 0, 0, 0};
+	glReadPixels(4, 4, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	for(unsigned int channel = 0; channel < 3; ++channel)
+		BU_GLW_CHECK(pixel[channel] == (((mask >> channel) & 1) ? 255 : 0));
+}
+
+static void test_defines_reach_the_shader(){
+	ShaderPermutations permutations(PermutationSources{vertex_source, fragment_source}, features, 3);
+	BU_GLW_CHECK(permutations.featureCount() == 3);
+	for(uint64_t mask = 0; mask < 8; ++mask)
+		draw_and_check(permutations.get(mask), mask);
+	BU_GLW_CHECK(permutations.compiledCount() == 8);
+}
+
+static void test_cached(){
+	ShaderPermutations permutations(PermutationSources{vertex_source, fragment_source}, features, 3);
+	BU_GLW_CHECK(!permutations.isCompiled(5));
+	ShaderProgram& first = permutations.get(5);
+	BU_GLW_CHECK(permutations.isCompiled(5));
+	BU_GLW_CHECK(permutations.compiledCount() == 1);
+
+	/* The same program, not compiled again. */
+	ShaderProgram& second = permutations.get(5);
+	BU_GLW_CHECK(&first == &second);
+	BU_GLW_CHECK(first.m_ID == second.m_ID);
+	BU_GLW_CHECK(permutations.compiledCount() == 1);
+	draw_and_check(second, 5);
+}
+
+static void test_warm_up(){
+	ShaderPermutations permutations(PermutationSources{vertex_source, fragment_source}, features, 3);
+	const uint64_t masks[3] = {1, 6, 1};
+	permutations.warmUp(masks, 3);
+	BU_GLW_CHECK(permutations.compiledCount() == 2);
+	BU_GLW_CHECK(permutations.isCompiled(1) && permutations.isCompiled(6));
+	BU_GLW_CHECK(!permutations.isCompiled(0));
+
+	draw_and_check(permutations.get(6), 6);
+	BU_GLW_CHECK(permutations.compiledCount() == 2);
+}
+
+static void test_out_of_range(){
+	ShaderPermutations permutations(PermutationSources{vertex_source, fragment_source}, features, 3);
+	BU_GLW_CHECK_THROWS(permutations.get(1 << 3), BuGlwOutOfBounds);
+	BU_GLW_CHECK_THROWS(permutations.get(~(uint64_t)0), BuGlwOutOfBounds);
+	BU_GLW_CHECK(permutations.compiledCount() == 0);
+
+	const char* too_many[BU_GLW_MAX_SHADER_FEATURES + 1];
+	for(unsigned int i = 0; i < BU_GLW_MAX_SHADER_FEATURES + 1; ++i)
+		too_many[i] = "FEATURE";
+	BU_GLW_CHECK_THROWS(ShaderPermutations(PermutationSources{vertex_source, fragment_source}, too_many, BU_GLW_MAX_SHADER_FEATURES + 1), BuGlwOutOfBounds);
+}
+
+static bool write_file(const char* path, const char* text){
+	FILE* file = fopen(path, "wb");
+	if(file == NULL)
+		return false;
+	bool written = fputs(text, file) >= 0;
+	return fclose(file) == 0 && written;
+}
+
+static void test_from_files(){
+	const char* vs_path = "bu_glw_test_permutations.vert";
+	const char* fs_path = "bu_glw_test_permutations.frag";
+	BU_GLW_CHECK(write_file(vs_path, vertex_source) && write_file(fs_path, fragment_source));
+	{
+		ShaderPermutations permutations(vs_path, fs_path, features, 3);
+		draw_and_check(permutations.get(3), 3);
+	}
+	BU_GLW_CHECK_THROWS(ShaderPermutations("bu_glw_test_permutations.missing", fs_path, features, 3), BuGlwBadFilePath);
+	remove(vs_path);
+	remove(fs_path);
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	RenderTarget color(RenderTargetDesc{16, 16, GL_RGBA8, 0, false});
+	Framebuffer framebuffer;
+	framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.validate();
+	framebuffer.bind();
+	glViewport(0, 0, 16, 16);
+
+	/* The core profile needs a vertex array bound to draw, even without attributes. */
+	VAO vao;
+	vao.bind();
+
+	test_defines_reach_the_shader();
+	test_cached();
+	test_warm_up();
+	test_out_of_range();
+	test_from_files();
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
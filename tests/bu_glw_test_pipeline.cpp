@@ -0,0 +1,152 @@
+/* Tests of program pipelines, built from StagePrograms or from a ShaderProgram linked as separable.
+ *
+ * Draws into an offscreen framebuffer in a headless context, so Mesa's llvmpipe is enough.
+ * Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_test.hpp"
+
+/* A triangle covering the whole viewport, without any vertex buffer. */
+static const GLchar* vertex_source =
+	"#version 430 core\n"
+	"out gl_PerVertex{ vec4 gl_Position; };\n"
+	"void main(){\n"
+	"	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+static const GLchar* red_source =
+	"#version 430 core\n"
+	"out vec4 color;\n"
+	"void main(){ color = vec4(1.0, 0.0, 0.0, 1.0); }\n";
+static const GLchar* green_source =
+	"#version 430 core\n"
+	"out vec4 color;\n"
+	"void main(){ color = vec4(0.0, 1.0, 0.0, 1.0); }\n";
+
+/* The colour comes from a uniform, to check that setting it targets this stage alone. */
+static const GLchar* tint_source =
+	"#version 430 core\n"
+	"out vec4 color;\n"
+	"uniform vec4 tint;\n"
+	"void main(){ color = tint; }\n";
+
+static void draw_and_check(ProgramPipeline& pipeline, GLubyte red, GLubyte green){
+	glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	pipeline.bind();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	pipeline.unbind();
+
+	GLubyte pixel[4] = {0, 0, 0, 0};
+	glReadPixels(4, 4, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	BU_GLW_CHECK(pixel[0] == red && pixel[1] == green && pixel[2] == 0);
+}
+
+static void test_separable_program(){
+	VertexShader vs(nullptr);
+	vs.compile(1, &vertex_source, NULL);
+	FragmentShader fs(nullptr);
+	fs.compile(1, &red_source, NULL);
+	ShaderProgram program(vs, fs, true);
+
+	GLint separable = GL_FALSE;
+	glGetProgramiv(program.m_ID, GL_PROGRAM_SEPARABLE, &separable);
+	BU_GLW_CHECK(separable == GL_TRUE);
+
+	/* Both stages of the program. */
+	ProgramPipeline pipeline;
+	pipeline.useStages(program, GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT);
+	BU_GLW_CHECK(pipeline.stageProgram(GL_VERTEX_SHADER) == program.m_ID);
+	BU_GLW_CHECK(pipeline.stageProgram(GL_FRAGMENT_SHADER) == program.m_ID);
+	BU_GLW_CHECK(pipeline.validate());
+	draw_and_check(pipeline, 255, 0);
+
+	/* GL only validates a pipeline using every stage a program was linked with, so replacing one fails. */
+	StageProgram green(GL_FRAGMENT_SHADER, 1, &green_source);
+	pipeline.useStage(green);
+	BU_GLW_CHECK(pipeline.stageProgram(GL_VERTEX_SHADER) == program.m_ID);
+	BU_GLW_CHECK(pipeline.stageProgram(GL_FRAGMENT_SHADER) == green.m_ID);
+	BU_GLW_CHECK(!pipeline.validate());
+
+	/* A pipeline shares the program with others. */
+	ProgramPipeline other;
+	other.useStages(program, GL_ALL_SHADER_BITS);
+	BU_GLW_CHECK(other.validate());
+	draw_and_check(other, 255, 0);
+}
+
+static void test_stage_programs(){
+	StageProgram vertex(GL_VERTEX_SHADER, 1, &vertex_source);
+	StageProgram fragment(GL_FRAGMENT_SHADER, 1, &tint_source);
+	BU_GLW_CHECK(vertex.stageBit() == GL_VERTEX_SHADER_BIT);
+	BU_GLW_CHECK(fragment.stageBit() == GL_FRAGMENT_SHADER_BIT);
+
+	ProgramPipeline pipeline;
+	pipeline.useStage(vertex);
+	pipeline.useStage(fragment);
+	BU_GLW_CHECK(pipeline.stageProgram(GL_VERTEX_SHADER) == vertex.m_ID);
+	BU_GLW_CHECK(pipeline.stageProgram(GL_FRAGMENT_SHADER) == fragment.m_ID);
+	BU_GLW_CHECK(pipeline.validate());
+
+	/* Set on the fragment stage while nothing is bound, then again while the pipeline is. */
+	GLint tint = fragment.getUniformLocation("tint");
+	fragment.setUniform(tint, 1.0f, 0.0f, 0.0f, 1.0f);
+	draw_and_check(pipeline, 255, 0);
+	pipeline.bind();
+	fragment.setUniform(tint, 0.0f, 1.0f, 0.0f, 1.0f);
+	draw_and_check(pipeline, 0, 255);
+
+	/* The vertex stage has no such uniform. */
+	BU_GLW_CHECK_THROWS(vertex.getUniformLocation("tint"), GLInexistentUniform);
+
+	/* Swapping the fragment stage keeps the vertex one. */
+	StageProgram green(GL_FRAGMENT_SHADER, 1, &green_source);
+	pipeline.useStage(green);
+	BU_GLW_CHECK(pipeline.stageProgram(GL_VERTEX_SHADER) == vertex.m_ID);
+	BU_GLW_CHECK(pipeline.validate());
+	draw_and_check(pipeline, 0, 255);
+	pipeline.useStage(fragment);
+	fragment.setUniform(tint, 1.0f, 1.0f, 0.0f, 1.0f);
+	draw_and_check(pipeline, 255, 255);
+}
+
+static void test_not_separable_by_default(){
+	VertexShader vs(nullptr);
+	vs.compile(1, &vertex_source, NULL);
+	FragmentShader fs(nullptr);
+	fs.compile(1, &red_source, NULL);
+	ShaderProgram program(vs, fs);
+
+	GLint separable = GL_TRUE;
+	glGetProgramiv(program.m_ID, GL_PROGRAM_SEPARABLE, &separable);
+	BU_GLW_CHECK(separable == GL_FALSE);
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	RenderTarget color(RenderTargetDesc{16, 16, GL_RGBA8, 0, false});
+	Framebuffer framebuffer;
+	framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.validate();
+	framebuffer.bind();
+	glViewport(0, 0, 16, 16);
+
+	/* The core profile needs a vertex array bound to draw, even without attributes. */
+	VAO vao;
+	vao.bind();
+
+	test_separable_program();
+	test_stage_programs();
+	test_not_separable_by_default();
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
@@ -0,0 +1,135 @@
+/* Tests of the generation-checked slot map behind the resource pools.
+ *
+ * ResourcePool<T> is plain cpu-side bookkeeping, so it is tested with a counting type
+ * instead of GL objects and needs no context.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_pool.hpp"
+#include "bu_glw_test.hpp"
+
+/* Move-only like the wrappers, counts the live objects to catch leaks and double destruction. */
+struct Counted{
+	int value;
+	static int alive;
+
+	Counted(int v) : value{v}{ alive++; };
+	Counted(Counted&& other) noexcept : value{other.value}{ other.value = -1; alive++; };
+	~Counted(){ alive--; };
+
+	Counted(const Counted&) = delete;
+	Counted& operator=(const Counted&) = delete;
+};
+int Counted::alive = 0;
+
+static void test_insert_and_get(){
+	ResourcePool<Counted> pool;
+	ResourceHandle<Counted> a = pool.emplace(1);
+	ResourceHandle<Counted> b = pool.insert(Counted(2));
+	ResourceHandle<Counted> c = pool.emplace(3);
+
+	BU_GLW_CHECK(pool.size() == 3);
+	BU_GLW_CHECK(Counted::alive == 3);
+	BU_GLW_CHECK(pool.valid(a) && pool.valid(b) && pool.valid(c));
+	BU_GLW_CHECK(pool.get(a)->value == 1);
+	BU_GLW_CHECK(pool.get(b)->value == 2);
+	BU_GLW_CHECK(pool.at(c).value == 3);
+
+	int sum = 0;
+	for(Counted& counted : pool)
+		sum += counted.value;
+	BU_GLW_CHECK(sum == 6);
+}
+
+static void test_stale_handles(){
+	ResourcePool<Counted> pool;
+	ResourceHandle<Counted> a = pool.emplace(1);
+	ResourceHandle<Counted> b = pool.emplace(2);
+	ResourceHandle<Counted> c = pool.emplace(3);
+
+	/* Removing from the middle moves the last object into the hole, the other handles must follow it. */
+	pool.remove(a);
+	BU_GLW_CHECK(pool.size() == 2);
+	BU_GLW_CHECK(Counted::alive == 2);
+	BU_GLW_CHECK(!pool.valid(a));
+	BU_GLW_CHECK(pool.get(a) == nullptr);
+	BU_GLW_CHECK_THROWS(pool.at(a), BuGlwStaleHandle);
+	BU_GLW_CHECK(pool.get(b)->value == 2);
+	BU_GLW_CHECK(pool.get(c)->value == 3);
+
+	/* A stale handle removes nothing. */
+	pool.remove(a);
+	BU_GLW_CHECK(pool.size() == 2);
+	BU_GLW_CHECK(pool.get(b)->value == 2 && pool.get(c)->value == 3);
+
+	/* Handles from nowhere are stale too. */
+	ResourceHandle<Counted> out_of_range = {100, 0};
+	BU_GLW_CHECK(!pool.valid(out_of_range));
+	BU_GLW_CHECK(pool.get(out_of_range) == nullptr);
+}
+
+static void test_slot_reuse(){
+	ResourcePool<Counted> pool;
+	ResourceHandle<Counted> a = pool.emplace(1);
+	ResourceHandle<Counted> b = pool.emplace(2);
+	pool.remove(a);
+
+	/* The freed slot is taken again with a new generation, so the old handle does not see the new object. */
+	ResourceHandle<Counted> d = pool.emplace(4);
+	BU_GLW_CHECK(d.index == a.index);
+	BU_GLW_CHECK(d.generation != a.generation);
+	BU_GLW_CHECK(!pool.valid(a));
+	BU_GLW_CHECK(pool.get(a) == nullptr);
+	BU_GLW_CHECK(pool.get(d)->value == 4);
+	BU_GLW_CHECK(pool.get(b)->value == 2);
+
+	/* The most recently freed slot goes first. */
+	pool.remove(b);
+	pool.remove(d);
+	ResourceHandle<Counted> e = pool.emplace(5);
+	ResourceHandle<Counted> f = pool.emplace(6);
+	BU_GLW_CHECK(e.index == d.index);
+	BU_GLW_CHECK(f.index == b.index);
+	BU_GLW_CHECK(!pool.valid(b) && !pool.valid(d));
+	BU_GLW_CHECK(pool.get(e)->value == 5 && pool.get(f)->value == 6);
+	BU_GLW_CHECK(pool.size() == 2);
+	BU_GLW_CHECK(Counted::alive == 2);
+}
+
+static void test_clear(){
+	ResourcePool<Counted> pool;
+	ResourceHandle<Counted> handles[8];
+	for(int i = 0; i < 8; ++i)
+		handles[i] = pool.emplace(i);
+	pool.remove(handles[3]);
+
+	pool.clear();
+	BU_GLW_CHECK(pool.empty());
+	BU_GLW_CHECK(Counted::alive == 0);
+	for(int i = 0; i < 8; ++i)
+		BU_GLW_CHECK(!pool.valid(handles[i]));
+
+	/* Every slot is free again, no new ones are needed. */
+	for(int i = 0; i < 8; ++i){
+		ResourceHandle<Counted> handle = pool.emplace(10 + i);
+		BU_GLW_CHECK(handle.index < 8);
+		BU_GLW_CHECK(pool.get(handle)->value == 10 + i);
+	}
+	for(int i = 0; i < 8; ++i)
+		BU_GLW_CHECK(!pool.valid(handles[i]));
+}
+
+int main(){
+	test_insert_and_get();
+	BU_GLW_CHECK(Counted::alive == 0);
+	test_stale_handles();
+	BU_GLW_CHECK(Counted::alive == 0);
+	test_slot_reuse();
+	BU_GLW_CHECK(Counted::alive == 0);
+	test_clear();
+	BU_GLW_CHECK(Counted::alive == 0);
+	return bu_glw_test_result();
+}
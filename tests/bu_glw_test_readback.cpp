@@ -0,0 +1,137 @@
+/* Tests of FrameReadback: frames arrive complete and in order whatever pack state the application left set.
+ *
+ * Reads back an offscreen framebuffer in a headless context, so Mesa's llvmpipe is enough.
+ * Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_readback.hpp"
+#include "bu_glw_test.hpp"
+
+#define WIDTH 13
+#define HEIGHT 7
+#define FRAMES 6
+
+struct Delivered{
+	unsigned int frames;
+	bool pixels_match;
+	bool in_order;
+};
+
+/* Frame n is cleared to red = n * 10, so every pixel tells which frame it came from. */
+static void check_frame(const ReadbackFrame& frame, void* user_data){
+	Delivered* delivered = (Delivered*)user_data;
+	delivered->in_order = delivered->in_order && frame.frame_number == delivered->frames;
+	delivered->frames++;
+	if(frame.width != WIDTH || frame.height != HEIGHT){
+		delivered->pixels_match = false;
+		return;
+	}
+	for(GLsizei y = 0; y < frame.height; ++y){
+		const unsigned char* row = frame.row(y);
+		for(GLsizei x = 0; x < frame.width; ++x){
+			const unsigned char* pixel = row + x * 4;
+			if(pixel[0] != frame.frame_number * 10 || pixel[1] != 0 || pixel[2] != 255 || pixel[3] != 255)
+				delivered->pixels_match = false;
+		}
+	}
+}
+
+static void test_pack_state_ignored(){
+	/* Left behind by some other read, these would shift and pad the rows if they were honored. */
+	glPixelStorei(GL_PACK_ROW_LENGTH, WIDTH * 2);
+	glPixelStorei(GL_PACK_SKIP_ROWS, 3);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, 5);
+	glPixelStorei(GL_PACK_ALIGNMENT, 8);
+
+	Delivered delivered = {0, true, true};
+	{
+		ReadbackOptions options;
+		options.ring_size = 3;
+		options.latency_frames = 1;
+		FrameReadback readback(check_frame, &delivered, options);
+		for(unsigned int frame = 0; frame < FRAMES; ++frame){
+			glClearColor(frame * 10 / 255.0f, 0.0f, 1.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			BU_GLW_CHECK(readback.capture(0, 0, WIDTH, HEIGHT));
+		}
+		readback.flush();
+
+		/* 13 pixels of 4 bytes, padded to the alignment of 8. */
+		ReadbackStats stats = readback.stats();
+		BU_GLW_CHECK(stats.bytes_delivered == (uint64_t)FRAMES * 56 * HEIGHT);
+	}
+	BU_GLW_CHECK(delivered.frames == FRAMES);
+	BU_GLW_CHECK(delivered.in_order);
+	BU_GLW_CHECK(delivered.pixels_match);
+
+	/* And they are restored afterwards. */
+	GLint value = 0;
+	glGetIntegerv(GL_PACK_ROW_LENGTH, &value);
+	BU_GLW_CHECK(value == WIDTH * 2);
+	glGetIntegerv(GL_PACK_SKIP_ROWS, &value);
+	BU_GLW_CHECK(value == 3);
+	glGetIntegerv(GL_PACK_SKIP_PIXELS, &value);
+	BU_GLW_CHECK(value == 5);
+
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+static void test_destructor_delivers(){
+	Delivered delivered = {0, true, true};
+	{
+		FrameReadback readback(check_frame, &delivered);
+		glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		readback.capture(0, 0, WIDTH, HEIGHT);
+	}
+	BU_GLW_CHECK(delivered.frames == 1);
+	BU_GLW_CHECK(delivered.pixels_match);
+}
+
+static void test_empty_rectangle(){
+	Delivered delivered = {0, true, true};
+	{
+		FrameReadback readback(check_frame, &delivered);
+		BU_GLW_CHECK_THROWS(readback.capture(0, 0, 0, HEIGHT), BuGlwOutOfBounds);
+		BU_GLW_CHECK_THROWS(readback.capture(0, 0, WIDTH, 0), BuGlwOutOfBounds);
+		BU_GLW_CHECK_THROWS(readback.capture(0, 0, -WIDTH, HEIGHT), BuGlwOutOfBounds);
+		BU_GLW_CHECK_THROWS(readback.capture(0, 0, WIDTH, -1), BuGlwOutOfBounds);
+		readback.flush();
+		/* Rejected ones are not counted as frames either. */
+		BU_GLW_CHECK(readback.stats().frames_captured == 0 && readback.stats().frames_dropped == 0);
+
+		glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		BU_GLW_CHECK(readback.capture(0, 0, WIDTH, HEIGHT));
+	}
+	BU_GLW_CHECK(delivered.frames == 1);
+	BU_GLW_CHECK(delivered.in_order);
+	BU_GLW_CHECK(delivered.pixels_match);
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	RenderTarget color(RenderTargetDesc{WIDTH, HEIGHT, GL_RGBA8, 0, false});
+	Framebuffer framebuffer;
+	framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.validate();
+	framebuffer.bind();
+
+	test_pack_state_ignored();
+	test_destructor_delivers();
+	test_empty_rectangle();
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
@@ -0,0 +1,330 @@
+/* Tests of the buffer residency manager: eviction within the budget, deferred uploads, restored contents, stale handles,
+ * buffers moved around by their pools, the memory accounting and untouched bindings.
+ *
+ * Runs in a headless context, so Mesa's llvmpipe is enough. Without any context the test is skipped.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_pool.hpp"
+#include "bu_glw_residency.hpp"
+#include "bu_glw_test.hpp"
+#include <string.h>
+
+#define FLOATS 256
+
+static GLint buffer_size(GLuint buffer){
+	GLint size = -1;
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	return size;
+}
+
+static bool buffer_holds(GLuint buffer, const float* data, size_t size){
+	float back[FLOATS];
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, back);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	return memcmp(back, data, size) == 0;
+}
+
+static void fill(float* data, float first){
+	for(int i = 0; i < FLOATS; ++i)
+		data[i] = first + (float)i;
+}
+
+static void test_null_data(){
+	ResidencyManager manager(1 << 20, 1 << 20);
+	VBOPool pool;
+	ResourceHandle<VBO> vbo = pool.create();
+	BU_GLW_CHECK_THROWS(manager.add(pool, vbo, nullptr, 16), BuGlwNullArgument);
+	BU_GLW_CHECK(manager.stats().registered_buffers == 0);
+
+	/* Nothing to copy, nothing to complain about. */
+	ResidentBuffer empty = manager.add(pool, vbo, nullptr, 0);
+	BU_GLW_CHECK(manager.use(empty));
+}
+
+static void test_eviction(){
+	float data[FLOATS];
+	fill(data, 0.0f);
+
+	/* Room for one buffer at a time. */
+	ResidencyManager manager(sizeof(data), 2 * sizeof(data));
+	VBOPool pool;
+	ResourceHandle<VBO> pooled_a = pool.create();
+	ResourceHandle<VBO> pooled_b = pool.create();
+	GLuint a = pool.at(pooled_a).id();
+	GLuint b = pool.at(pooled_b).id();
+	ResidentBuffer handle_a = manager.add(pool, pooled_a, data, sizeof(data));
+	ResidentBuffer handle_b = manager.add(pool, pooled_b, data, sizeof(data), BU_GLW_BACKING_BORROWED);
+	BU_GLW_CHECK(buffer_size(a) == 0 && buffer_size(b) == 0);
+
+	BU_GLW_CHECK(manager.use(handle_a));
+	manager.endFrame();
+	BU_GLW_CHECK(manager.use(handle_b));
+	BU_GLW_CHECK(manager.isResident(handle_b));
+	BU_GLW_CHECK(!manager.isResident(handle_a));
+	BU_GLW_CHECK(buffer_size(a) == 0);
+	BU_GLW_CHECK(buffer_size(b) == (GLint)sizeof(data));
+	manager.endFrame();
+
+	/* The copy brings a's contents back. */
+	BU_GLW_CHECK(manager.use(handle_a));
+	BU_GLW_CHECK(buffer_holds(a, data, sizeof(data)));
+
+	ResidencyStats stats = manager.stats();
+	BU_GLW_CHECK(stats.uploads == 3);
+	BU_GLW_CHECK(stats.evictions == 2);
+	BU_GLW_CHECK(stats.resident_bytes <= sizeof(data));
+}
+
+static void test_bindings_kept(){
+	unsigned int indices[6] = {0, 1, 2, 2, 1, 3};
+	float vertices[8] = {0};
+	ResidencyManager manager(1 << 20, 1 << 20);
+
+	/* Created first, the constructors may bind. */
+	VAO vao;
+	EBO bound_ebo;
+	VBO bound_vbo;
+	VBOPool vbos;
+	EBOPool ebos;
+	ResourceHandle<VBO> vbo = vbos.create();
+	ResourceHandle<EBO> ebo = ebos.create();
+
+	/* What the application has bound while the manager uploads and evicts. */
+	vao.bind();
+	bound_ebo.bind();
+	bound_vbo.bind();
+	ResidentBuffer handle_vbo = manager.add(vbos, vbo, vertices, sizeof(vertices));
+	ResidentBuffer handle_ebo = manager.add(ebos, ebo, indices, sizeof(indices));
+	BU_GLW_CHECK(manager.use(handle_vbo));
+	BU_GLW_CHECK(manager.use(handle_ebo));
+	manager.setBudget(0);
+	manager.endFrame();
+	BU_GLW_CHECK(!manager.isResident(handle_vbo) && !manager.isResident(handle_ebo));
+
+	GLint binding = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &binding);
+	BU_GLW_CHECK((GLuint)binding == vao.id());
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &binding);
+	BU_GLW_CHECK((GLuint)binding == bound_ebo.id());
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &binding);
+	BU_GLW_CHECK((GLuint)binding == bound_vbo.id());
+
+	/* The element binding of VAO 0, used while storing EBOs, is left alone too. */
+	vao.unbind();
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &binding);
+	BU_GLW_CHECK(binding == 0);
+}
+
+static void test_deferred_uploads(){
+	float data[3][FLOATS];
+	for(int i = 0; i < 3; ++i)
+		fill(data[i], i * 1000.0f);
+
+	/* Less than one buffer may be uploaded per frame, the first upload of a frame is done anyway. */
+	ResidencyManager manager(1 << 20, sizeof(data[0]) / 2);
+	VBOPool pool;
+	ResidentBuffer handles[3];
+	ResourceHandle<VBO> pooled[3];
+	for(int i = 0; i < 3; ++i){
+		pooled[i] = pool.create();
+		handles[i] = manager.add(pool, pooled[i], data[i], sizeof(data[i]));
+	}
+
+	BU_GLW_CHECK(manager.use(handles[0]));
+	BU_GLW_CHECK(!manager.use(handles[1]));
+	BU_GLW_CHECK(!manager.use(handles[2]));
+	/* Asking again counts, but queues nothing twice. */
+	BU_GLW_CHECK(!manager.use(handles[1]));
+	BU_GLW_CHECK(manager.stats().deferred_uploads == 3);
+	BU_GLW_CHECK(manager.stats().uploads == 1);
+	BU_GLW_CHECK(buffer_size(pool.at(pooled[1]).id()) == 0);
+
+	/* One per frame, in the order they were asked for. */
+	manager.endFrame();
+	BU_GLW_CHECK(manager.isResident(handles[1]) && !manager.isResident(handles[2]));
+	BU_GLW_CHECK(manager.stats().uploads == 2);
+	BU_GLW_CHECK(manager.stats().uploaded_this_frame == sizeof(data[1]));
+	BU_GLW_CHECK(buffer_holds(pool.at(pooled[1]).id(), data[1], sizeof(data[1])));
+	/* The frame's upload budget went to the request. */
+	BU_GLW_CHECK(!manager.use(handles[2]));
+
+	manager.endFrame();
+	BU_GLW_CHECK(manager.isResident(handles[2]));
+	BU_GLW_CHECK(manager.stats().uploads == 3);
+	BU_GLW_CHECK(buffer_holds(pool.at(pooled[2]).id(), data[2], sizeof(data[2])));
+	BU_GLW_CHECK(manager.use(handles[2]));
+
+	/* Nothing left to do. */
+	manager.endFrame();
+	BU_GLW_CHECK(manager.stats().uploads == 3);
+	BU_GLW_CHECK(manager.stats().resident_buffers == 3);
+}
+
+static void test_remove(){
+	float data[FLOATS];
+	fill(data, 0.0f);
+	ResidencyManager manager(1 << 20, sizeof(data));
+	VBOPool pool;
+	ResourceHandle<VBO> pooled_a = pool.create();
+	ResourceHandle<VBO> pooled_b = pool.create();
+	ResidentBuffer a = manager.add(pool, pooled_a, data, sizeof(data));
+	ResidentBuffer b = manager.add(pool, pooled_b, data, sizeof(data));
+	BU_GLW_CHECK(manager.use(a));
+	BU_GLW_CHECK(!manager.use(b));
+
+	/* A resident buffer keeps its storage, but is no longer counted. */
+	manager.remove(a);
+	ResidencyStats stats = manager.stats();
+	BU_GLW_CHECK(stats.registered_buffers == 1 && stats.registered_bytes == sizeof(data));
+	BU_GLW_CHECK(stats.resident_buffers == 0 && stats.resident_bytes == 0);
+	BU_GLW_CHECK(buffer_size(pool.at(pooled_a).id()) == (GLint)sizeof(data));
+	BU_GLW_CHECK(!manager.isResident(a));
+	BU_GLW_CHECK_THROWS(manager.use(a), BuGlwStaleHandle);
+
+	/* Removing twice does nothing. */
+	manager.remove(a);
+	BU_GLW_CHECK(manager.stats().registered_buffers == 1);
+
+	/* A deferred upload is dropped with its buffer. */
+	manager.remove(b);
+	manager.endFrame();
+	BU_GLW_CHECK(manager.stats().uploads == 1);
+	BU_GLW_CHECK(buffer_size(pool.at(pooled_b).id()) == 0);
+	BU_GLW_CHECK(manager.stats().registered_buffers == 0 && manager.stats().registered_bytes == 0);
+}
+
+static void test_stale_handles(){
+	float data[FLOATS];
+	fill(data, 0.0f);
+	ResidencyManager manager(1 << 20, 1 << 20);
+	VBOPool pool;
+	ResourceHandle<VBO> pooled = pool.create();
+	ResidentBuffer first = manager.add(pool, pooled, data, sizeof(data));
+	manager.remove(first);
+
+	/* The entry is reused for the next buffer, the old handle must not reach it. */
+	ResidentBuffer second = manager.add(pool, pooled, data, sizeof(data));
+	BU_GLW_CHECK(second.index == first.index && second.generation != first.generation);
+	BU_GLW_CHECK_THROWS(manager.use(first), BuGlwStaleHandle);
+	BU_GLW_CHECK(manager.use(second));
+	BU_GLW_CHECK(!manager.isResident(first) && manager.isResident(second));
+	manager.remove(first);
+	BU_GLW_CHECK(manager.isResident(second));
+
+	/* Never handed out. */
+	BU_GLW_CHECK_THROWS(manager.use(ResidentBuffer{second.index + 1, 0}), BuGlwStaleHandle);
+	BU_GLW_CHECK(!manager.isResident(ResidentBuffer{second.index + 1, 0}));
+
+	/* Stale pool handles are not registered at all. */
+	ResourceHandle<VBO> gone = pool.create();
+	pool.remove(gone);
+	BU_GLW_CHECK_THROWS(manager.add(pool, gone, data, sizeof(data)), BuGlwStaleHandle);
+	BU_GLW_CHECK(manager.stats().registered_buffers == 1);
+
+	/* Removed from the pool while registered. */
+	ResourceHandle<VBO> doomed = pool.create();
+	ResidentBuffer registered = manager.add(pool, doomed, data, sizeof(data));
+	pool.remove(doomed);
+	BU_GLW_CHECK_THROWS(manager.use(registered), BuGlwStaleHandle);
+	manager.remove(registered);
+}
+
+static void test_moved_by_pool(){
+	float data[3][FLOATS];
+	for(int i = 0; i < 3; ++i)
+		fill(data[i], i * 1000.0f);
+
+	/* Room for two buffers, so the third evicts one. */
+	ResidencyManager manager(2 * sizeof(data[0]), 1 << 20);
+	VBOPool pool;
+	ResourceHandle<VBO> pooled[3];
+	ResidentBuffer handles[3];
+	for(int i = 0; i < 3; ++i){
+		pooled[i] = pool.create();
+		handles[i] = manager.add(pool, pooled[i], data[i], sizeof(data[i]));
+	}
+	BU_GLW_CHECK(manager.use(handles[0]));
+	BU_GLW_CHECK(manager.use(handles[2]));
+	manager.endFrame();
+
+	/* The last buffer moves into the place of the removed one, and growing the pool moves every buffer. */
+	manager.remove(handles[0]);
+	pool.remove(pooled[0]);
+	for(int i = 0; i < 64; ++i)
+		pool.create();
+
+	BU_GLW_CHECK(manager.use(handles[1]));
+	BU_GLW_CHECK(manager.use(handles[2]));
+	BU_GLW_CHECK(buffer_holds(pool.at(pooled[1]).id(), data[1], sizeof(data[1])));
+	BU_GLW_CHECK(buffer_holds(pool.at(pooled[2]).id(), data[2], sizeof(data[2])));
+	BU_GLW_CHECK(pool.at(pooled[1]).size() == (GLsizeiptr)sizeof(data[1]));
+
+	/* Evicting goes through the pool as well. */
+	manager.setBudget(0);
+	manager.endFrame();
+	BU_GLW_CHECK(buffer_size(pool.at(pooled[1]).id()) == 0 && buffer_size(pool.at(pooled[2]).id()) == 0);
+	BU_GLW_CHECK(pool.at(pooled[2]).size() == 0);
+}
+
+static void test_memory_accounting(){
+#if BU_GLW_TRACK_MEMORY
+	float vertices[FLOATS];
+	fill(vertices, 0.0f);
+	unsigned int indices[FLOATS / 2];
+	for(unsigned int i = 0; i < FLOATS / 2; ++i)
+		indices[i] = i;
+
+	ResidencyManager manager(1 << 20, 1 << 20);
+	VBOPool vbos;
+	EBOPool ebos;
+	ResidentBuffer vbo = manager.add(vbos, vbos.create(), vertices, sizeof(vertices));
+	ResidentBuffer ebo = manager.add(ebos, ebos.create(), indices, sizeof(indices));
+	GpuMemoryStats before = bu_glw_memory_stats();
+
+	/* Each upload lands in its own category. */
+	BU_GLW_CHECK(manager.use(vbo));
+	GpuMemoryStats stats = bu_glw_memory_stats();
+	BU_GLW_CHECK(stats.bytes[BU_GLW_MEMORY_VERTEX_BUFFERS] - before.bytes[BU_GLW_MEMORY_VERTEX_BUFFERS] == (int64_t)sizeof(vertices));
+	BU_GLW_CHECK(stats.bytes[BU_GLW_MEMORY_INDEX_BUFFERS] == before.bytes[BU_GLW_MEMORY_INDEX_BUFFERS]);
+	BU_GLW_CHECK(stats.allocations[BU_GLW_MEMORY_VERTEX_BUFFERS] == before.allocations[BU_GLW_MEMORY_VERTEX_BUFFERS] + 1);
+
+	BU_GLW_CHECK(manager.use(ebo));
+	stats = bu_glw_memory_stats();
+	BU_GLW_CHECK(stats.bytes[BU_GLW_MEMORY_INDEX_BUFFERS] - before.bytes[BU_GLW_MEMORY_INDEX_BUFFERS] == (int64_t)sizeof(indices));
+	BU_GLW_CHECK(stats.total_bytes - before.total_bytes == (int64_t)(sizeof(vertices) + sizeof(indices)));
+	BU_GLW_CHECK(stats.peak_bytes[BU_GLW_MEMORY_VERTEX_BUFFERS] >= stats.bytes[BU_GLW_MEMORY_VERTEX_BUFFERS]);
+
+	/* Evicting gives it all back. */
+	manager.setBudget(0);
+	manager.endFrame();
+	stats = bu_glw_memory_stats();
+	BU_GLW_CHECK(stats.bytes[BU_GLW_MEMORY_VERTEX_BUFFERS] == before.bytes[BU_GLW_MEMORY_VERTEX_BUFFERS]);
+	BU_GLW_CHECK(stats.bytes[BU_GLW_MEMORY_INDEX_BUFFERS] == before.bytes[BU_GLW_MEMORY_INDEX_BUFFERS]);
+	BU_GLW_CHECK(stats.total_bytes == before.total_bytes);
+#endif
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	test_null_data();
+	test_eviction();
+	test_bindings_kept();
+	test_deferred_uploads();
+	test_remove();
+	test_stale_handles();
+	test_moved_by_pool();
+	test_memory_accounting();
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
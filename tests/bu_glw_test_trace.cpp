@@ -0,0 +1,228 @@
+/* Tests of trace capture and parsing: records written through a TraceWriter must come back the same from bu_glw_trace_parse().
+ *
+ * The records are made up rather than coming from wrapper calls, so no context is needed.
+ * The trace goes to a file in the working directory, which is removed afterwards.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw_trace.hpp"
+#include "bu_glw_test.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define TRACE_PATH "bu_glw_test_trace.bugt"
+
+/* Whole words, so the parser gets the alignment it needs. */
+static std::vector<uint32_t> read_trace(size_t& size){
+	std::vector<uint32_t> words;
+	size = 0;
+	FILE* file = fopen(TRACE_PATH, "rb");
+	if(file == NULL)
+		return words;
+	unsigned char buffer[4096];
+	std::vector<unsigned char> bytes;
+	size_t read;
+	while( (read = fread(buffer, 1, sizeof(buffer), file)) != 0 )
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+	size = bytes.size();
+	words.resize((size + 3) / 4);
+	if(size != 0)
+		memcpy(words.data(), bytes.data(), size);
+	return words;
+}
+
+static uint64_t payload_id(const TraceRecord& record, unsigned int at){
+	return bu_glw_trace_join(record.words[at], record.words[at + 1]);
+}
+
+static bool payload_is(const TraceContents& trace, uint64_t id, const void* data, size_t size){
+	std::unordered_map<uint64_t, TracePayload>::const_iterator found = trace.payloads.find(id);
+	return found != trace.payloads.end() && found->second.size == size && memcmp(found->second.data, data, size) == 0;
+}
+
+static void test_round_trip(){
+	/* Not a multiple of 4 long, so the padding is exercised. */
+	static const unsigned char vertices[13] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+	TraceWriter writer;
+	BU_GLW_CHECK(!writer.enabled());
+	writer.begin(TRACE_PATH);
+	BU_GLW_CHECK(writer.enabled());
+
+	uint32_t create[1] = {7};
+	writer.record(BU_GLW_TRACE_CREATE_BUFFER, create, 1);
+	uint32_t data[7] = {0x8892, 7, 0x88E4, sizeof(vertices), 0, 0, 0};
+	writer.record(BU_GLW_TRACE_BUFFER_DATA, data, 7, 5, vertices, sizeof(vertices));
+	writer.frame();
+	/* The same bytes again are only referred to. */
+	uint32_t sub_data[8] = {0x8892, 7, 0, 0, sizeof(vertices), 0, 0, 0};
+	writer.record(BU_GLW_TRACE_BUFFER_SUB_DATA, sub_data, 8, 6, vertices, sizeof(vertices));
+	uint32_t empty[7] = {0x8892, 7, 0x88E4, 64, 0, 0xdead, 0xbeef};
+	writer.record(BU_GLW_TRACE_BUFFER_DATA, empty, 7, 5, nullptr, 64);
+	writer.frame();
+	/* Left in an unfinished frame. */
+	uint32_t draw[3] = {4, 0, 3};
+	writer.record(BU_GLW_TRACE_DRAW_ARRAYS, draw, 3);
+	writer.end();
+	BU_GLW_CHECK(!writer.enabled());
+
+	/* Nothing is recorded after the end. */
+	writer.record(BU_GLW_TRACE_DRAW_ARRAYS, draw, 3);
+
+	size_t size;
+	std::vector<uint32_t> file = read_trace(size);
+	TraceContents trace;
+	BU_GLW_CHECK(bu_glw_trace_parse((const unsigned char*)file.data(), size, trace));
+	BU_GLW_CHECK(trace.records.size() == 5);
+	BU_GLW_CHECK(trace.frame_ends.size() == 3);
+	BU_GLW_CHECK(trace.payloads.size() == 1);
+	if(trace.records.size() != 5 || trace.frame_ends.size() != 3)
+		return;
+	BU_GLW_CHECK(trace.frame_ends[0] == 2 && trace.frame_ends[1] == 4 && trace.frame_ends[2] == 5);
+
+	BU_GLW_CHECK(trace.records[0].opcode == BU_GLW_TRACE_CREATE_BUFFER);
+	BU_GLW_CHECK(trace.records[0].count == 1 && trace.records[0].words[0] == 7);
+	BU_GLW_CHECK(trace.records[1].opcode == BU_GLW_TRACE_BUFFER_DATA);
+	BU_GLW_CHECK(memcmp(trace.records[1].words, data, 5 * sizeof(uint32_t)) == 0);
+	BU_GLW_CHECK(trace.records[2].opcode == BU_GLW_TRACE_BUFFER_SUB_DATA);
+	BU_GLW_CHECK(payload_id(trace.records[1], 5) == bu_glw_trace_hash(vertices, sizeof(vertices)));
+	BU_GLW_CHECK(payload_id(trace.records[2], 6) == payload_id(trace.records[1], 5));
+	BU_GLW_CHECK(payload_is(trace, payload_id(trace.records[1], 5), vertices, sizeof(vertices)));
+	/* No data, no payload, whatever was in the words before. */
+	BU_GLW_CHECK(payload_id(trace.records[3], 5) == 0);
+	BU_GLW_CHECK(trace.records[4].opcode == BU_GLW_TRACE_DRAW_ARRAYS);
+	BU_GLW_CHECK(trace.records[4].count == 3 && memcmp(trace.records[4].words, draw, sizeof(draw)) == 0);
+
+	/* Cut short within the last record, everything before it is still there. */
+	TraceContents cut;
+	BU_GLW_CHECK(bu_glw_trace_parse((const unsigned char*)file.data(), size - 4, cut));
+	BU_GLW_CHECK(cut.records.size() == 4);
+
+	/* Not a trace. */
+	TraceContents garbage;
+	static const unsigned char not_a_trace[8] = {'B', 'U', 'G', 'X', 2, 0, 0, 0};
+	BU_GLW_CHECK(!bu_glw_trace_parse(not_a_trace, sizeof(not_a_trace), garbage));
+}
+
+static uint64_t colliding_hash(const void*, size_t){
+	return 42;
+}
+
+static void test_hash_collisions(){
+	static const char first[8] = "first..";
+	static const char second[8] = "second.";
+	static const char longer[12] = "longer one.";
+	TraceWriter writer(colliding_hash);
+	writer.begin(TRACE_PATH);
+	uint32_t words[4] = {1, 0x8B31, 0, 0};
+	writer.record(BU_GLW_TRACE_SHADER_SOURCE, words, 4, 2, first, sizeof(first));
+	writer.record(BU_GLW_TRACE_SHADER_SOURCE, words, 4, 2, second, sizeof(second));
+	writer.record(BU_GLW_TRACE_SHADER_SOURCE, words, 4, 2, first, sizeof(first));
+	writer.record(BU_GLW_TRACE_SHADER_SOURCE, words, 4, 2, longer, sizeof(longer));
+	writer.end();
+
+	size_t size;
+	std::vector<uint32_t> file = read_trace(size);
+	TraceContents trace;
+	BU_GLW_CHECK(bu_glw_trace_parse((const unsigned char*)file.data(), size, trace));
+	BU_GLW_CHECK(trace.records.size() == 4);
+	BU_GLW_CHECK(trace.payloads.size() == 3);
+	if(trace.records.size() != 4)
+		return;
+	/* Same hash, different bytes: each gets an id of its own, the first one the hash. */
+	BU_GLW_CHECK(payload_id(trace.records[0], 2) == 42);
+	BU_GLW_CHECK(payload_id(trace.records[1], 2) == 43);
+	BU_GLW_CHECK(payload_id(trace.records[2], 2) == 42);
+	BU_GLW_CHECK(payload_id(trace.records[3], 2) == 44);
+	BU_GLW_CHECK(payload_is(trace, 42, first, sizeof(first)));
+	BU_GLW_CHECK(payload_is(trace, 43, second, sizeof(second)));
+	BU_GLW_CHECK(payload_is(trace, 44, longer, sizeof(longer)));
+}
+
+static void test_payload_memory(){
+	static const char first[8] = "first..";
+	static const char second[8] = "second.";
+	static const char third[8] = "third..";
+	static const char large[20] = "larger than kept...";
+	/* Room for two of them. */
+	TraceWriter writer(bu_glw_trace_hash, 16);
+	writer.begin(TRACE_PATH);
+	const char* order[8] = {first, second, first, third, first, second, large, large};
+	const size_t sizes[8] = {8, 8, 8, 8, 8, 8, 20, 20};
+	for(int i = 0; i < 8; ++i){
+		uint32_t words[4] = {1, 0x8B31, 0, 0};
+		writer.record(BU_GLW_TRACE_SHADER_SOURCE, words, 4, 2, order[i], sizes[i]);
+	}
+	writer.end();
+
+	size_t size;
+	std::vector<uint32_t> file = read_trace(size);
+	TraceContents trace;
+	BU_GLW_CHECK(bu_glw_trace_parse((const unsigned char*)file.data(), size, trace));
+	BU_GLW_CHECK(trace.records.size() == 8);
+	if(trace.records.size() != 8)
+		return;
+	uint64_t first_id = bu_glw_trace_hash(first, sizeof(first));
+	/* Still kept the second time. */
+	BU_GLW_CHECK(payload_id(trace.records[0], 2) == first_id);
+	BU_GLW_CHECK(payload_id(trace.records[2], 2) == first_id);
+	/* third pushed out first, which is then written again under the next id. */
+	BU_GLW_CHECK(payload_id(trace.records[4], 2) == first_id + 1);
+	BU_GLW_CHECK(payload_is(trace, first_id, first, sizeof(first)));
+	BU_GLW_CHECK(payload_is(trace, first_id + 1, first, sizeof(first)));
+	/* And that pushed out second. */
+	BU_GLW_CHECK(payload_id(trace.records[5], 2) == bu_glw_trace_hash(second, sizeof(second)) + 1);
+	/* Too large to be kept at all, so written every time. */
+	BU_GLW_CHECK(payload_id(trace.records[6], 2) != payload_id(trace.records[7], 2));
+	BU_GLW_CHECK(payload_is(trace, payload_id(trace.records[7], 2), large, sizeof(large)));
+	BU_GLW_CHECK(trace.payloads.size() == 7);
+	/* Every record still refers to its own content. */
+	for(int i = 0; i < 8; ++i)
+		BU_GLW_CHECK(payload_is(trace, payload_id(trace.records[i], 2), order[i], sizes[i]));
+}
+
+static void test_end_while_recording(){
+	TraceWriter writer;
+	writer.begin(TRACE_PATH);
+	/* Keeps recording through the end, every record must land whole or not at all. */
+	std::thread recorder([&writer]{
+		static const unsigned char payload[6] = {'a', 'b', 'c', 'd', 'e', 'f'};
+		for(uint32_t i = 0; i < 200000; ++i){
+			uint32_t draw[3] = {4, i, 3};
+			writer.record(BU_GLW_TRACE_DRAW_ARRAYS, draw, 3);
+			uint32_t location[4] = {1, i, 0, 0};
+			writer.record(BU_GLW_TRACE_UNIFORM_LOCATION, location, 4, 2, payload, sizeof(payload));
+		}
+	});
+	for(unsigned int spins = 0; spins < 1000; ++spins)
+		std::this_thread::yield();
+	writer.end();
+	recorder.join();
+
+	size_t size;
+	std::vector<uint32_t> file = read_trace(size);
+	TraceContents trace;
+	BU_GLW_CHECK(bu_glw_trace_parse((const unsigned char*)file.data(), size, trace));
+	bool in_order = true;
+	for(size_t i = 0; i < trace.records.size(); ++i){
+		const TraceRecord& record = trace.records[i];
+		in_order = in_order && record.opcode == (i % 2 == 0 ? BU_GLW_TRACE_DRAW_ARRAYS : BU_GLW_TRACE_UNIFORM_LOCATION);
+		in_order = in_order && record.words[1] == i / 2;
+	}
+	BU_GLW_CHECK(in_order);
+	BU_GLW_CHECK(trace.payloads.size() <= 1);
+}
+
+int main(){
+	test_round_trip();
+	test_hash_collisions();
+	test_payload_memory();
+	test_end_while_recording();
+	remove(TRACE_PATH);
+	return bu_glw_test_result();
+}
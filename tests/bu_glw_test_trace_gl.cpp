@@ -0,0 +1,227 @@
+/* Tests of tracing real wrapper calls: buffers, a vertex array, a program with a uniform and draws must come back from
+ * bu_glw_trace_parse() as the records and payloads of those calls.
+ *
+ * Always built with BU_GLW_TRACE, against a build of the library with tracing if the main one has none.
+ * Runs in a headless context, so Mesa's llvmpipe is enough. Without any context the test is skipped.
+ * The trace goes to a file in the working directory, which is removed afterwards.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include "bu_glw.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_headless.hpp"
+#include "bu_glw_trace.hpp"
+#include "bu_glw_test.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#if !BU_GLW_TRACE
+#error "bu_glw_test_trace_gl needs the wrappers built with BU_GLW_TRACE."
+#endif
+
+#define TRACE_PATH "bu_glw_test_trace_gl.bugt"
+
+static const char* vertex_source =
+	"#version 430 core\n"
+	"layout(location = 0) in vec2 position;\n"
+	"void main(){\n"
+	"	gl_Position = vec4(position, 0.0, 1.0);\n"
+	"}\n";
+static const char* fragment_source =
+	"#version 430 core\n"
+	"uniform vec4 tint;\n"
+	"out vec4 color;\n"
+	"void main(){\n"
+	"	color = tint;\n"
+	"}\n";
+
+/* Covers the whole viewport. */
+static const float vertices[6] = {-1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f};
+static const unsigned int indices[3] = {0, 1, 2};
+
+/* Whole words, so the parser gets the alignment it needs. */
+static std::vector<uint32_t> read_trace(size_t& size){
+	std::vector<uint32_t> words;
+	size = 0;
+	FILE* file = fopen(TRACE_PATH, "rb");
+	if(file == NULL)
+		return words;
+	unsigned char buffer[4096];
+	std::vector<unsigned char> bytes;
+	size_t read;
+	while( (read = fread(buffer, 1, sizeof(buffer), file)) != 0 )
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+	size = bytes.size();
+	words.resize((size + 3) / 4);
+	if(size != 0)
+		memcpy(words.data(), bytes.data(), size);
+	return words;
+}
+
+static uint64_t payload_id(const TraceRecord& record, unsigned int at){
+	return bu_glw_trace_join(record.words[at], record.words[at + 1]);
+}
+
+static bool payload_is(const TraceContents& trace, uint64_t id, const void* data, size_t size){
+	std::unordered_map<uint64_t, TracePayload>::const_iterator found = trace.payloads.find(id);
+	return found != trace.payloads.end() && found->second.size == size && memcmp(found->second.data, data, size) == 0;
+}
+
+static uint32_t float_word(float value){
+	uint32_t word;
+	memcpy(&word, &value, sizeof(word));
+	return word;
+}
+
+/* Walks through the records in order, skipping those the checks do not care about, e.g. extra binds. */
+struct TraceCursor{
+	const TraceContents& trace;
+	size_t next;
+
+	/* The next record with the opcode and the given leading words, nullptr if there is none. */
+	const TraceRecord* find(TraceOpcode opcode, std::vector<uint32_t> words = std::vector<uint32_t>()){
+		for(; next < trace.records.size(); ++next){
+			const TraceRecord& record = trace.records[next];
+			if(record.opcode != opcode || record.count < words.size())
+				continue;
+			if(!words.empty() && memcmp(record.words, words.data(), words.size() * sizeof(uint32_t)) != 0)
+				continue;
+			return &trace.records[next++];
+		}
+		return nullptr;
+	}
+};
+
+/* What the calls below are expected to leave in the trace. */
+struct Captured{
+	GLuint vbo, ebo, vao, program;
+	GLint tint;
+};
+
+static Captured capture(){
+	Captured captured;
+	bu_glw_trace_begin(TRACE_PATH);
+	BU_GLW_CHECK(bu_glw_tracing());
+
+	VBO vbo(vertices, 6);
+	EBO ebo(indices, 3);
+	VAO vao;
+	vao.bind();
+	vbo.bind();
+	ebo.bind();
+	vao.add_attribute(2);
+	vao.bind_attributes();
+
+	VertexShader vs(nullptr);
+	vs.compile(1, &vertex_source, NULL);
+	FragmentShader fs(nullptr);
+	fs.compile(1, &fragment_source, NULL);
+	ShaderProgram program(vs, fs);
+	program.use();
+	/* The first uniform registered has the ID 0. */
+	program.registerUniform("tint");
+	program.setUniform(0u, 0.25f, 0.5f, 0.75f, 1.0f);
+	bu_glw_draw_elements(GL_TRIANGLES, 3, GL_UNSIGNED_INT);
+	bu_glw_trace_frame();
+
+	/* The same vertices again are only referred to. */
+	vbo.partial_data(0, vertices, 6);
+	bu_glw_draw_arrays(GL_TRIANGLES, 0, 3);
+	bu_glw_trace_end();
+	BU_GLW_CHECK(!bu_glw_tracing());
+
+	/* Nothing is recorded after the end. */
+	bu_glw_draw_arrays(GL_TRIANGLES, 0, 3);
+
+	GLubyte pixel[4] = {0, 0, 0, 0};
+	glReadPixels(4, 4, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	BU_GLW_CHECK(pixel[0] >= 63 && pixel[0] <= 64 && pixel[1] >= 127 && pixel[1] <= 128 && pixel[2] >= 191 && pixel[2] <= 192);
+
+	captured.vbo = vbo.id();
+	captured.ebo = ebo.id();
+	captured.vao = vao.id();
+	captured.program = program.m_ID;
+	captured.tint = glGetUniformLocation(program.m_ID, "tint");
+	return captured;
+}
+
+static void check_trace(const Captured& captured){
+	size_t size;
+	std::vector<uint32_t> file = read_trace(size);
+	TraceContents trace;
+	BU_GLW_CHECK(bu_glw_trace_parse((const unsigned char*)file.data(), size, trace));
+	BU_GLW_CHECK(trace.frame_ends.size() == 2);
+	TraceCursor cursor = {trace, 0};
+
+	/* Buffers: created, then filled with the arrays as payloads. */
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_CREATE_BUFFER, {captured.vbo}) != nullptr);
+	const TraceRecord* vertex_data = cursor.find(BU_GLW_TRACE_BUFFER_DATA, {GL_ARRAY_BUFFER, captured.vbo, GL_STATIC_DRAW, sizeof(vertices), 0});
+	BU_GLW_CHECK(vertex_data != nullptr);
+	if(vertex_data == nullptr)
+		return;
+	BU_GLW_CHECK(payload_is(trace, payload_id(*vertex_data, 5), vertices, sizeof(vertices)));
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_CREATE_BUFFER, {captured.ebo}) != nullptr);
+	const TraceRecord* index_data = cursor.find(BU_GLW_TRACE_BUFFER_DATA, {GL_ELEMENT_ARRAY_BUFFER, captured.ebo, GL_STATIC_DRAW, sizeof(indices), 0});
+	BU_GLW_CHECK(index_data != nullptr && payload_is(trace, payload_id(*index_data, 5), indices, sizeof(indices)));
+
+	/* The vertex array and its attribute. */
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_CREATE_VERTEX_ARRAY, {captured.vao}) != nullptr);
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_BIND_VERTEX_ARRAY, {captured.vao}) != nullptr);
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_VERTEX_ATTRIB, {0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0, 0}) != nullptr);
+
+	/* Sources go in with their terminator, the shaders are attached to the program they were compiled for. */
+	const TraceRecord* vertex_shader = cursor.find(BU_GLW_TRACE_SHADER_SOURCE);
+	BU_GLW_CHECK(vertex_shader != nullptr && vertex_shader->words[1] == GL_VERTEX_SHADER);
+	const TraceRecord* fragment_shader = cursor.find(BU_GLW_TRACE_SHADER_SOURCE);
+	BU_GLW_CHECK(fragment_shader != nullptr && fragment_shader->words[1] == GL_FRAGMENT_SHADER);
+	if(vertex_shader == nullptr || fragment_shader == nullptr)
+		return;
+	BU_GLW_CHECK(payload_is(trace, payload_id(*vertex_shader, 2), vertex_source, strlen(vertex_source) + 1));
+	BU_GLW_CHECK(payload_is(trace, payload_id(*fragment_shader, 2), fragment_source, strlen(fragment_source) + 1));
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_ATTACH_SHADER, {captured.program, vertex_shader->words[0]}) != nullptr);
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_ATTACH_SHADER, {captured.program, fragment_shader->words[0]}) != nullptr);
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_LINK_PROGRAM, {captured.program, 0}) != nullptr);
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_USE_PROGRAM, {captured.program}) != nullptr);
+
+	/* The uniform by name, then its value as plain glUniform4f. */
+	const TraceRecord* location = cursor.find(BU_GLW_TRACE_UNIFORM_LOCATION, {captured.program, (uint32_t)captured.tint});
+	BU_GLW_CHECK(location != nullptr && payload_is(trace, payload_id(*location, 2), "tint", 5));
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_UNIFORM, {captured.program, (uint32_t)captured.tint, BU_GLW_TRACE_UNIFORM_FLOAT, 4, 0,
+		float_word(0.25f), float_word(0.5f), float_word(0.75f), float_word(1.0f)}) != nullptr);
+
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_DRAW_ELEMENTS, {GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0, 0}) != nullptr);
+	BU_GLW_CHECK(cursor.next == trace.frame_ends[0]);
+
+	/* The second frame refers to the vertices already in the trace. */
+	const TraceRecord* sub_data = cursor.find(BU_GLW_TRACE_BUFFER_SUB_DATA, {GL_ARRAY_BUFFER, captured.vbo, 0, 0, sizeof(vertices), 0});
+	BU_GLW_CHECK(sub_data != nullptr && payload_id(*sub_data, 6) == payload_id(*vertex_data, 5));
+	BU_GLW_CHECK(cursor.find(BU_GLW_TRACE_DRAW_ARRAYS, {GL_TRIANGLES, 0, 3}) != nullptr);
+	/* And that was the last record, the draw after the end is not in there. */
+	BU_GLW_CHECK(cursor.next == trace.records.size());
+	BU_GLW_CHECK(trace.frame_ends.size() == 2 && trace.frame_ends[1] == trace.records.size());
+
+	/* Vertices, indices, two sources and a uniform name. */
+	BU_GLW_CHECK(trace.payloads.size() == 5);
+}
+
+int main(){
+	if( !bu_glw_headless_context() )
+		return BU_GLW_TEST_SKIPPED;
+
+	RenderTarget color(RenderTargetDesc{16, 16, GL_RGBA8, 0, false});
+	Framebuffer framebuffer;
+	framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.validate();
+	framebuffer.bind();
+	glViewport(0, 0, 16, 16);
+
+	check_trace(capture());
+	remove(TRACE_PATH);
+	BU_GLW_CHECK(glGetError() == GL_NO_ERROR);
+	return bu_glw_test_result();
+}
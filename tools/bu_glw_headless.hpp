@@ -0,0 +1,61 @@
+/* Headless contexts for Benoe's Utilities: OpenGL wrappers
+ *
+ * Creates an OpenGL 4.3+ core context without any window or surface through EGL, so the
+ * tools and tests can run on machines without a display, e.g. on Mesa's llvmpipe.
+ * Drawing has to go to framebuffers created by the caller.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+#ifndef BU_GLW_HEADLESS_HEADER
+#define BU_GLW_HEADLESS_HEADER
+
+#include <stdio.h>
+#include "bu_glw.hpp"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/* Create a surfaceless context, make it current and load the OpenGL functions.
+ * Returns false, after printing why, if that is not possible here. */
+static inline bool bu_glw_headless_context(){
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if(get_platform_display != NULL)
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if(display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	EGLint major, minor;
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)){
+		fprintf(stderr, "Could not initialize EGL.\n");
+		return false;
+	}
+	if(!eglBindAPI(EGL_OPENGL_API)){
+		fprintf(stderr, "EGL does not support desktop OpenGL.\n");
+		return false;
+	}
+
+	/* Compute shaders and glProgramUniform need at least 4.3, ask for more first. */
+	static const EGLint versions[][2] = { {4, 6}, {4, 5}, {4, 3} };
+	EGLContext context = EGL_NO_CONTEXT;
+	for(size_t i = 0; i < sizeof(versions) / sizeof(versions[0]) && context == EGL_NO_CONTEXT; ++i){
+		EGLint attributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, versions[i][0],
+			EGL_CONTEXT_MINOR_VERSION, versions[i][1],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	}
+	if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)){
+		fprintf(stderr, "Could not create a surfaceless OpenGL 4.3+ core context (0x%x).\n", eglGetError());
+		return false;
+	}
+	if(gl3wInit2((GL3WGetProcAddressProc)eglGetProcAddress) != 0){
+		fprintf(stderr, "Could not load the OpenGL functions.\n");
+		return false;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,284 @@
+/* Mesh converter for Benoe's Utilities: OpenGL wrappers
+ *
+ * Converts Wavefront OBJ files into the binary mesh format of bu_glw_mesh_format.hpp.
+ * Faces are triangulated as fans and vertices sharing the same position/texcoord/normal
+ * indices are merged.
+ *
+ * Usage: bu_glw_meshconv [--meshlets] input.obj output.bumf
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <tuple>
+#include <vector>
+#include "bu_glw_mesh_format.hpp"
+
+/* Meshlet limits, the usual sizes for mesh shading hardware. */
+#define BU_GLW_MESHLET_MAX_VERTICES 64
+#define BU_GLW_MESHLET_MAX_TRIANGLES 124
+
+typedef std::tuple<int, int, int> ObjCorner; /* Position, texcoord and normal index, -1 if missing. */
+
+struct ObjData{
+	std::vector<float> positions;
+	std::vector<float> texcoords;
+	std::vector<float> normals;
+	std::vector<ObjCorner> corners; /* Three per triangle. */
+};
+
+/* OBJ indices start at 1, negative ones count back from the last element. */
+static int resolve_index(long index, size_t count){
+	if(index > 0)
+		return (int)(index - 1);
+	if(index < 0)
+		return (int)((long)count + index);
+	return -1;
+}
+
+static bool parse_corner(const char* token, const ObjData& obj, ObjCorner& corner){
+	char* end;
+	long v = strtol(token, &end, 10);
+	long vt = 0, vn = 0;
+	if(end == token)
+		return false;
+	if(*end == '/'){
+		const char* next = end + 1;
+		if(*next != '/')
+			vt = strtol(next, &end, 10);
+		else
+			end = (char*)next;
+		if(*end == '/')
+			vn = strtol(end + 1, &end, 10);
+	}
+	corner = ObjCorner(
+		resolve_index(v, obj.positions.size() / 3),
+		resolve_index(vt, obj.texcoords.size() / 2),
+		resolve_index(vn, obj.normals.size() / 3)
+	);
+	return std::get<0>(corner) >= 0 && (size_t)std::get<0>(corner) < obj.positions.size() / 3;
+}
+
+static bool read_obj(const char* path, ObjData& obj){
+	FILE* file = fopen(path, "r");
+	if(file == NULL){
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+	char line[4096];
+	unsigned int line_number = 0;
+	while( fgets(line, sizeof(line), file) != NULL ){
+		line_number++;
+		float x = 0, y = 0, z = 0;
+		if( strncmp(line, "v ", 2) == 0 ){
+			sscanf(line + 2, "%f %f %f", &x, &y, &z);
+			obj.positions.push_back(x);
+			obj.positions.push_back(y);
+			obj.positions.push_back(z);
+		}else if( strncmp(line, "vt ", 3) == 0 ){
+			sscanf(line + 3, "%f %f", &x, &y);
+			obj.texcoords.push_back(x);
+			obj.texcoords.push_back(y);
+		}else if( strncmp(line, "vn ", 3) == 0 ){
+			sscanf(line + 3, "%f %f %f", &x, &y, &z);
+			obj.normals.push_back(x);
+			obj.normals.push_back(y);
+			obj.normals.push_back(z);
+		}else if( strncmp(line, "f ", 2) == 0 ){
+			std::vector<ObjCorner> face;
+			for(char* token = strtok(line + 2, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n")){
+				ObjCorner corner;
+				if( !parse_corner(token, obj, corner) ){
+					fprintf(stderr, "%s:%u: bad face corner '%s'\n", path, line_number, token);
+					fclose(file);
+					return false;
+				}
+				face.push_back(corner);
+			}
+			for(size_t i = 2; i < face.size(); ++i){
+				obj.corners.push_back(face[0]);
+				obj.corners.push_back(face[i - 1]);
+				obj.corners.push_back(face[i]);
+			}
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+/* Greedily pack consecutive triangles into meshlets. */
+static void build_meshlets(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, uint32_t stride_floats, std::vector<MeshFileMeshlet>& meshlets){
+	size_t triangle = 0;
+	size_t triangle_count = indices.size() / 3;
+	while(triangle < triangle_count){
+		MeshFileMeshlet meshlet;
+		meshlet.index_offset = (uint32_t)(triangle * 3);
+		std::vector<uint32_t> unique;
+		size_t first = triangle;
+		while(triangle < triangle_count && triangle - first < BU_GLW_MESHLET_MAX_TRIANGLES){
+			size_t added = 0;
+			for(int c = 0; c < 3; ++c){
+				uint32_t index = indices[triangle * 3 + c];
+				bool found = false;
+				for(size_t u = 0; u < unique.size(); ++u)
+					found = found || unique[u] == index;
+				if(!found)
+					added++;
+			}
+			if(unique.size() + added > BU_GLW_MESHLET_MAX_VERTICES)
+				break;
+			for(int c = 0; c < 3; ++c){
+				uint32_t index = indices[triangle * 3 + c];
+				bool found = false;
+				for(size_t u = 0; u < unique.size(); ++u)
+					found = found || unique[u] == index;
+				if(!found)
+					unique.push_back(index);
+			}
+			triangle++;
+		}
+		meshlet.index_count = (uint32_t)((triangle - first) * 3);
+
+		/* Bounding sphere around the center of the bounding box. Not the tightest, but cheap and good enough for culling. */
+		float low[3] = {INFINITY, INFINITY, INFINITY};
+		float high[3] = {-INFINITY, -INFINITY, -INFINITY};
+		for(size_t u = 0; u < unique.size(); ++u){
+			const float* position = &vertices[unique[u] * stride_floats];
+			for(int a = 0; a < 3; ++a){
+				low[a] = position[a] < low[a] ? position[a] : low[a];
+				high[a] = position[a] > high[a] ? position[a] : high[a];
+			}
+		}
+		float radius = 0;
+		for(int a = 0; a < 3; ++a)
+			meshlet.center[a] = (low[a] + high[a]) * 0.5f;
+		for(size_t u = 0; u < unique.size(); ++u){
+			const float* position = &vertices[unique[u] * stride_floats];
+			float dx = position[0] - meshlet.center[0];
+			float dy = position[1] - meshlet.center[1];
+			float dz = position[2] - meshlet.center[2];
+			float distance = sqrtf(dx*dx + dy*dy + dz*dz);
+			radius = distance > radius ? distance : radius;
+		}
+		meshlet.radius = radius;
+		meshlets.push_back(meshlet);
+	}
+}
+
+static bool write_padding(FILE* file, uint64_t from, uint64_t to){
+	static const char zeros[BU_GLW_MESH_ALIGNMENT] = {0};
+	return fwrite(zeros, 1, (size_t)(to - from), file) == (size_t)(to - from);
+}
+
+int main(int argc, char** argv){
+	bool meshlets_wanted = false;
+	const char* input = NULL;
+	const char* output = NULL;
+	for(int i = 1; i < argc; ++i){
+		if( strcmp(argv[i], "--meshlets") == 0 )
+			meshlets_wanted = true;
+		else if(input == NULL)
+			input = argv[i];
+		else if(output == NULL)
+			output = argv[i];
+	}
+	if(input == NULL || output == NULL){
+		fprintf(stderr, "Usage: %s [--meshlets] input.obj output.bumf\n", argv[0]);
+		return 1;
+	}
+
+	ObjData obj;
+	if( !read_obj(input, obj) )
+		return 1;
+
+	bool has_texcoords = false;
+	bool has_normals = false;
+	for(size_t i = 0; i < obj.corners.size(); ++i){
+		has_texcoords = has_texcoords || std::get<1>(obj.corners[i]) >= 0;
+		has_normals = has_normals || std::get<2>(obj.corners[i]) >= 0;
+	}
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BU_GLW_MESH_MAGIC, 4);
+	header.version = BU_GLW_MESH_VERSION;
+	header.index_type = BU_GLW_MESH_UNSIGNED_INT;
+	header.attributes[header.attribute_count++] = MeshFileAttribute{3, BU_GLW_MESH_FLOAT, sizeof(float), 0};
+	if(has_texcoords)
+		header.attributes[header.attribute_count++] = MeshFileAttribute{2, BU_GLW_MESH_FLOAT, sizeof(float), 0};
+	if(has_normals)
+		header.attributes[header.attribute_count++] = MeshFileAttribute{3, BU_GLW_MESH_FLOAT, sizeof(float), 0};
+	uint32_t stride_floats = 3 + (has_texcoords ? 2 : 0) + (has_normals ? 3 : 0);
+	header.vertex_stride = stride_floats * sizeof(float);
+
+	/* Merge identical corners into one vertex. */
+	std::map<ObjCorner, uint32_t> known;
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	indices.reserve(obj.corners.size());
+	for(size_t i = 0; i < obj.corners.size(); ++i){
+		const ObjCorner& corner = obj.corners[i];
+		std::map<ObjCorner, uint32_t>::iterator found = known.find(corner);
+		if(found != known.end()){
+			indices.push_back(found->second);
+			continue;
+		}
+		uint32_t index = (uint32_t)(vertices.size() / stride_floats);
+		int p = std::get<0>(corner), t = std::get<1>(corner), n = std::get<2>(corner);
+		vertices.insert(vertices.end(), &obj.positions[p * 3], &obj.positions[p * 3] + 3);
+		if(has_texcoords){
+			bool valid = t >= 0 && (size_t)t < obj.texcoords.size() / 2;
+			vertices.push_back(valid ? obj.texcoords[t * 2] : 0.0f);
+			vertices.push_back(valid ? obj.texcoords[t * 2 + 1] : 0.0f);
+		}
+		if(has_normals){
+			bool valid = n >= 0 && (size_t)n < obj.normals.size() / 3;
+			vertices.push_back(valid ? obj.normals[n * 3] : 0.0f);
+			vertices.push_back(valid ? obj.normals[n * 3 + 1] : 0.0f);
+			vertices.push_back(valid ? obj.normals[n * 3 + 2] : 0.0f);
+		}
+		known[corner] = index;
+		indices.push_back(index);
+	}
+
+	std::vector<MeshFileMeshlet> meshlets;
+	if(meshlets_wanted)
+		build_meshlets(indices, vertices, stride_floats, meshlets);
+
+	header.vertex_count = vertices.size() / stride_floats;
+	header.index_count = indices.size();
+	header.meshlet_count = (uint32_t)meshlets.size();
+	header.vertex_offset = bu_glw_mesh_align(sizeof(MeshFileHeader));
+	header.index_offset = bu_glw_mesh_align(header.vertex_offset + vertices.size() * sizeof(float));
+	header.meshlet_offset = meshlets.empty() ? 0 : bu_glw_mesh_align(header.index_offset + indices.size() * sizeof(uint32_t));
+
+	FILE* file = fopen(output, "wb");
+	if(file == NULL){
+		fprintf(stderr, "Could not open %s for writing\n", output);
+		return 1;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && write_padding(file, sizeof(header), header.vertex_offset);
+	ok = ok && fwrite(vertices.data(), sizeof(float), vertices.size(), file) == vertices.size();
+	ok = ok && write_padding(file, header.vertex_offset + vertices.size() * sizeof(float), header.index_offset);
+	ok = ok && fwrite(indices.data(), sizeof(uint32_t), indices.size(), file) == indices.size();
+	if(!meshlets.empty()){
+		ok = ok && write_padding(file, header.index_offset + indices.size() * sizeof(uint32_t), header.meshlet_offset);
+		ok = ok && fwrite(meshlets.data(), sizeof(MeshFileMeshlet), meshlets.size(), file) == meshlets.size();
+	}
+	ok = (fclose(file) == 0) && ok;
+	if(!ok){
+		fprintf(stderr, "Failed to write %s\n", output);
+		return 1;
+	}
+
+	printf("%s: %llu vertices, %llu indices, %u meshlets\n", output,
+		(unsigned long long)header.vertex_count, (unsigned long long)header.index_count, header.meshlet_count);
+	return 0;
+}
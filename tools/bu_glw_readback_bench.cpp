@@ -0,0 +1,196 @@
+/* Readback benchmark for Benoe's Utilities: OpenGL wrappers
+ *
+ * Renders the same frames twice, once read back with a plain glReadPixels into client memory
+ * and once through FrameReadback, and reports the frame rate of both and how long the GL
+ * thread spent reading. Both loops do the same work per frame: one full screen draw whose
+ * cost is set with --iterations, the read, and a checksum of the pixels as the consumer.
+ *
+ * Whether the ring is a win depends on the GPU working while the CPU does something else.
+ * On a software rasterizer with a single core there is nothing to overlap and both come out
+ * about equal; measure on the hardware the readback is meant for.
+ *
+ * Usage: bu_glw_readback_bench [--size WxH] [--frames N] [--iterations N] [--ring N] [--latency N] [--bgra]
+ *   --size        Size of the frames, 1920x1080 by default.
+ *   --frames      Frames per loop, 120 by default.
+ *   --iterations  Loop iterations of the fragment shader, to load the GPU. 0 by default.
+ *   --ring        ReadbackOptions::ring_size.
+ *   --latency     ReadbackOptions::latency_frames.
+ *   --bgra        Read GL_BGRA instead of GL_RGBA.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "bu_glw.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_readback.hpp"
+#include "bu_glw_headless.hpp"
+
+#define BU_GLW_BENCH_DEFAULT_FRAMES 120
+
+/* Keeps the checksums from being optimized away. */
+static volatile uint64_t bu_glw_bench_sink;
+
+static double milliseconds(std::chrono::steady_clock::duration duration){
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/* Touches one word in every eight, enough to pull every cache line of the frame in. */
+static uint64_t checksum(const unsigned char* data, ptrdiff_t stride, GLsizei width, GLsizei height){
+	uint64_t sum = 0;
+	for(GLsizei y = 0; y < height; ++y){
+		const unsigned char* row = data + stride * y;
+		for(size_t x = 0; x + 8 <= (size_t)width * 4; x += 64){
+			uint64_t word;
+			memcpy(&word, row + x, 8);
+			sum += word;
+		}
+	}
+	return sum;
+}
+
+static void consume(const ReadbackFrame& frame, void*){
+	bu_glw_bench_sink += checksum(frame.data, frame.stride, frame.width, frame.height);
+}
+
+/* A triangle covering the viewport, with a fragment shader as expensive as asked for. */
+static const GLchar* vertex_source =
+	"#version 430 core\n"
+	"void main(){\n"
+	"	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+static std::string fragment_source(long iterations){
+	return "#version 430 core\n"
+		"out vec4 color;\n"
+		"uniform float time;\n"
+		"void main(){\n"
+		"	vec2 p = gl_FragCoord.xy / 1000.0;\n"
+		"	float a = time;\n"
+		"	for(int i = 0; i < " + std::to_string(iterations) + "; ++i)\n"
+		"		a = sin(a + p.x) * cos(a - p.y);\n"
+		"	color = vec4(a, p, 1.0);\n"
+		"}\n";
+}
+
+struct LoopResult{
+	double frames_per_second;
+	double read_ms; /* Per frame, on the GL thread. */
+};
+
+int main(int argc, char** argv){
+	GLsizei width = 1920;
+	GLsizei height = 1080;
+	long frames = BU_GLW_BENCH_DEFAULT_FRAMES;
+	long iterations = 0;
+	ReadbackOptions options;
+	bool bad_arguments = false;
+	for(int i = 1; i < argc; ++i){
+		if( strcmp(argv[i], "--size") == 0 && i + 1 < argc ){
+			if( sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0 )
+				bad_arguments = true;
+		}else if( strcmp(argv[i], "--frames") == 0 && i + 1 < argc ){
+			frames = strtol(argv[++i], NULL, 10);
+		}else if( strcmp(argv[i], "--iterations") == 0 && i + 1 < argc ){
+			iterations = strtol(argv[++i], NULL, 10);
+		}else if( strcmp(argv[i], "--ring") == 0 && i + 1 < argc ){
+			options.ring_size = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}else if( strcmp(argv[i], "--latency") == 0 && i + 1 < argc ){
+			options.latency_frames = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}else if( strcmp(argv[i], "--bgra") == 0 ){
+			options.format = GL_BGRA;
+		}else{
+			bad_arguments = true;
+		}
+	}
+	if(frames < 1 || iterations < 0 || bad_arguments){
+		fprintf(stderr, "Usage: %s [--size WxH] [--frames N] [--iterations N] [--ring N] [--latency N] [--bgra]\n", argv[0]);
+		return 1;
+	}
+
+	try{
+		if( !bu_glw_headless_context() )
+			return 1;
+
+		RenderTarget color(RenderTargetDesc{width, height, GL_RGBA8, 0, false});
+		Framebuffer framebuffer;
+		framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+		framebuffer.validate();
+		framebuffer.bind();
+		glViewport(0, 0, width, height);
+
+		VertexShader vs(nullptr);
+		vs.compile(1, &vertex_source, NULL);
+		FragmentShader fs(nullptr);
+		std::string source = fragment_source(iterations);
+		const GLchar* fs_source = source.c_str();
+		fs.compile(1, &fs_source, NULL);
+		ShaderProgram program(vs, fs);
+		GLint time = glGetUniformLocation(program.m_ID, "time");
+		program.use();
+		VAO vao;
+		vao.bind();
+
+		/* Same frame number, same pixels, in both loops. */
+		auto render = [&](long frame){
+			glUniform1f(time, (GLfloat)(frame * 0.01));
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		};
+		for(long frame = 0; frame < 3; ++frame)
+			render(frame);
+		glFinish();
+
+		LoopResult plain, ring;
+		std::vector<unsigned char> pixels((size_t)width * height * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		double read_ms = 0;
+		for(long frame = 0; frame < frames; ++frame){
+			render(frame);
+			std::chrono::steady_clock::time_point read_start = std::chrono::steady_clock::now();
+			glReadPixels(0, 0, width, height, options.format, GL_UNSIGNED_BYTE, pixels.data());
+			read_ms += milliseconds(std::chrono::steady_clock::now() - read_start);
+			bu_glw_bench_sink += checksum(pixels.data(), (ptrdiff_t)width * 4, width, height);
+		}
+		plain.frames_per_second = frames / (milliseconds(std::chrono::steady_clock::now() - start) / 1000.0);
+		plain.read_ms = read_ms / frames;
+
+		ReadbackStats stats;
+		start = std::chrono::steady_clock::now();
+		read_ms = 0;
+		{
+			FrameReadback readback(consume, nullptr, options);
+			for(long frame = 0; frame < frames; ++frame){
+				render(frame);
+				std::chrono::steady_clock::time_point read_start = std::chrono::steady_clock::now();
+				readback.capture(0, 0, width, height);
+				read_ms += milliseconds(std::chrono::steady_clock::now() - read_start);
+			}
+			readback.flush();
+			stats = readback.stats();
+		}
+		ring.frames_per_second = frames / (milliseconds(std::chrono::steady_clock::now() - start) / 1000.0);
+		ring.read_ms = read_ms / frames;
+
+		printf("%dx%d, %ld frames, %ld iterations, ring %u, latency %u on %s\n", width, height, frames, iterations,
+			options.ring_size, options.latency_frames, (const char*)glGetString(GL_RENDERER));
+		printf("%-14s %10s %16s\n", "", "fps", "read ms/frame");
+		printf("%-14s %10.1f %16.3f\n", "glReadPixels", plain.frames_per_second, plain.read_ms);
+		printf("%-14s %10.1f %16.3f\n", "FrameReadback", ring.frames_per_second, ring.read_ms);
+		printf("FrameReadback: %+.1f%% fps, %.3f ms average latency, %llu frames dropped\n",
+			(ring.frames_per_second / plain.frames_per_second - 1.0) * 100.0, stats.average_latency_ms, (unsigned long long)stats.frames_dropped);
+	}catch(std::exception& e){
+		fprintf(stderr, "Benchmark failed: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,464 @@
+/* Trace replayer for Benoe's Utilities: OpenGL wrappers
+ *
+ * Replays a trace captured with bu_glw_trace_begin() (see bu_glw_trace_format.hpp) in a
+ * headless EGL context, e.g. on llvmpipe, and reports how long every kind of call and every
+ * frame took. Drawing goes to an offscreen framebuffer which is cleared at the start of each
+ * frame, as framebuffers, textures and raw GL calls of the application are not in traces.
+ *
+ * Usage: bu_glw_replay [--size WxH] [--loop FRAME] [--loops N] [--calls] trace.bugt
+ *   --size    Size of the offscreen framebuffer, 1280x720 by default.
+ *   --loop    Replay up to FRAME, then FRAME another N times (100 by default) and report only those.
+ *             Objects the frame deletes are recreated empty on the next run.
+ *   --calls   Print every call of the reported frames with its time.
+ *
+ * For license see LICENSE.
+ *
+ * Project worked on by:
+ * 2022 - present: Thomas Benoe */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include "bu_glw.hpp"
+#include "bu_glw_framebuffer.hpp"
+#include "bu_glw_trace.hpp"
+#include "bu_glw_headless.hpp"
+
+#define BU_GLW_REPLAY_DEFAULT_LOOPS 100
+
+struct CallStats{
+	uint64_t count;
+	double total_ms;
+	double max_ms;
+};
+
+struct FrameStats{
+	size_t calls;
+	size_t draws;
+	double submit_ms; /* Issuing the calls. */
+	double total_ms; /* Until glFinish returned. */
+	unsigned int errors;
+};
+
+static double milliseconds(std::chrono::steady_clock::duration duration){
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/************************** Replaying ***************************/
+
+class Replayer{
+	const std::unordered_map<uint64_t, TracePayload>& m_payloads;
+	/* Names from the trace to names of this context. */
+	std::unordered_map<uint32_t, GLuint> m_buffers;
+	std::unordered_map<uint32_t, GLuint> m_vertex_arrays;
+	std::unordered_map<uint32_t, GLuint> m_shaders;
+	std::unordered_map<uint32_t, GLuint> m_programs;
+	std::unordered_map<uint32_t, GLuint> m_pipelines;
+	std::unordered_map<uint64_t, GLint> m_locations; /* By traced program << 32 | traced location. */
+
+	const void* payload(uint32_t low, uint32_t high){
+		uint64_t id = bu_glw_trace_join(low, high);
+		if(id == 0)
+			return NULL;
+		std::unordered_map<uint64_t, TracePayload>::const_iterator found = m_payloads.find(id);
+		if(found == m_payloads.end()){
+			fprintf(stderr, "Payload %016llx is missing from the trace.\n", (unsigned long long)id);
+			return NULL;
+		}
+		return found->second.data;
+	}
+
+	GLuint buffer(uint32_t id){
+		if(id == 0)
+			return 0;
+		GLuint& name = m_buffers[id];
+		if(name == 0)
+			glGenBuffers(1, &name);
+		return name;
+	}
+
+	GLuint vertexArray(uint32_t id){
+		if(id == 0)
+			return 0;
+		GLuint& name = m_vertex_arrays[id];
+		if(name == 0)
+			glGenVertexArrays(1, &name);
+		return name;
+	}
+
+	/* A create record means a new object, even if the name was seen before. It is created right away like with the
+	 * glCreate* calls, so records which do not bind it first find it. */
+	void createBuffer(uint32_t id){
+		erase(m_buffers, id, deleteBuffer);
+		GLuint& name = m_buffers[id];
+#if BU_GLW_GL_VERSION_AT_LEAST(4, 5)
+		glCreateBuffers(1, &name);
+#else
+		glGenBuffers(1, &name);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, name);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+#endif
+	}
+
+	void createVertexArray(uint32_t id){
+		erase(m_vertex_arrays, id, deleteVertexArray);
+		GLuint& name = m_vertex_arrays[id];
+#if BU_GLW_GL_VERSION_AT_LEAST(4, 5)
+		glCreateVertexArrays(1, &name);
+#else
+		GLint bound = 0;
+		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &bound);
+		glGenVertexArrays(1, &name);
+		glBindVertexArray(name);
+		glBindVertexArray((GLuint)bound);
+#endif
+	}
+
+	GLuint program(uint32_t id){
+		if(id == 0)
+			return 0;
+		GLuint& name = m_programs[id];
+		if(name == 0)
+			name = glCreateProgram();
+		return name;
+	}
+
+	GLuint pipeline(uint32_t id){
+		if(id == 0)
+			return 0;
+		GLuint& name = m_pipelines[id];
+		if(name == 0)
+			glGenProgramPipelines(1, &name);
+		return name;
+	}
+
+	GLint location(uint32_t program_id, uint32_t location_id){
+		std::unordered_map<uint64_t, GLint>::const_iterator found = m_locations.find(bu_glw_trace_join(location_id, program_id));
+		return found != m_locations.end() ? found->second : (GLint)location_id;
+	}
+
+	void uniform(const uint32_t* w){
+		GLuint target = program(w[0]);
+		GLint where = location(w[0], w[1]);
+		bool separable = w[4] != 0;
+		union{ GLfloat f[4]; GLint i[4]; GLuint u[4]; } values;
+		memcpy(&values, w + 5, sizeof(values));
+		switch(w[2] * 4 + w[3] - 1){
+			case BU_GLW_TRACE_UNIFORM_FLOAT * 4 + 0: separable ? glProgramUniform1fv(target, where, 1, values.f) : glUniform1fv(where, 1, values.f); break;
+			case BU_GLW_TRACE_UNIFORM_FLOAT * 4 + 1: separable ? glProgramUniform2fv(target, where, 1, values.f) : glUniform2fv(where, 1, values.f); break;
+			case BU_GLW_TRACE_UNIFORM_FLOAT * 4 + 2: separable ? glProgramUniform3fv(target, where, 1, values.f) : glUniform3fv(where, 1, values.f); break;
+			case BU_GLW_TRACE_UNIFORM_FLOAT * 4 + 3: separable ? glProgramUniform4fv(target, where, 1, values.f) : glUniform4fv(where, 1, values.f); break;
+			case BU_GLW_TRACE_UNIFORM_INT * 4 + 0: separable ? glProgramUniform1iv(target, where, 1, values.i) : glUniform1iv(where, 1, values.i); break;
+			case BU_GLW_TRACE_UNIFORM_INT * 4 + 1: separable ? glProgramUniform2iv(target, where, 1, values.i) : glUniform2iv(where, 1, values.i); break;
+			case BU_GLW_TRACE_UNIFORM_INT * 4 + 2: separable ? glProgramUniform3iv(target, where, 1, values.i) : glUniform3iv(where, 1, values.i); break;
+			case BU_GLW_TRACE_UNIFORM_INT * 4 + 3: separable ? glProgramUniform4iv(target, where, 1, values.i) : glUniform4iv(where, 1, values.i); break;
+			case BU_GLW_TRACE_UNIFORM_UINT * 4 + 0: separable ? glProgramUniform1uiv(target, where, 1, values.u) : glUniform1uiv(where, 1, values.u); break;
+			case BU_GLW_TRACE_UNIFORM_UINT * 4 + 1: separable ? glProgramUniform2uiv(target, where, 1, values.u) : glUniform2uiv(where, 1, values.u); break;
+			case BU_GLW_TRACE_UNIFORM_UINT * 4 + 2: separable ? glProgramUniform3uiv(target, where, 1, values.u) : glUniform3uiv(where, 1, values.u); break;
+			case BU_GLW_TRACE_UNIFORM_UINT * 4 + 3: separable ? glProgramUniform4uiv(target, where, 1, values.u) : glUniform4uiv(where, 1, values.u); break;
+			default:
+				fprintf(stderr, "Uniform of unknown type %u or size %u.\n", w[2], w[3]);
+		}
+	}
+
+	static void erase(std::unordered_map<uint32_t, GLuint>& names, uint32_t id, void (*destroy)(GLuint)){
+		std::unordered_map<uint32_t, GLuint>::iterator found = names.find(id);
+		if(found == names.end())
+			return;
+		destroy(found->second);
+		names.erase(found);
+	}
+	static void deleteBuffer(GLuint name){ glDeleteBuffers(1, &name); }
+	static void deleteVertexArray(GLuint name){ glDeleteVertexArrays(1, &name); }
+	static void deleteShader(GLuint name){ glDeleteShader(name); }
+	static void deleteProgram(GLuint name){ glDeleteProgram(name); }
+	static void deletePipeline(GLuint name){ glDeleteProgramPipelines(1, &name); }
+
+public:
+	Replayer(const std::unordered_map<uint64_t, TracePayload>& payloads) : m_payloads{payloads}{};
+
+	/* Returns true for draws and dispatches. */
+	bool execute(const TraceRecord& record){
+		const uint32_t* w = record.words;
+		switch(record.opcode){
+			case BU_GLW_TRACE_CREATE_BUFFER:
+				createBuffer(w[0]);
+				return false;
+			case BU_GLW_TRACE_BIND_BUFFER:
+				glBindBuffer(w[0], buffer(w[1]));
+				return false;
+			case BU_GLW_TRACE_BIND_BUFFER_BASE:
+				glBindBufferBase(w[0], w[1], buffer(w[2]));
+				return false;
+			case BU_GLW_TRACE_BIND_BUFFER_RANGE:
+				glBindBufferRange(w[0], w[1], buffer(w[2]), (GLintptr)bu_glw_trace_join(w[3], w[4]), (GLsizeiptr)bu_glw_trace_join(w[5], w[6]));
+				return false;
+			case BU_GLW_TRACE_BUFFER_DATA:
+				glBindBuffer(w[0], buffer(w[1]));
+				glBufferData(w[0], (GLsizeiptr)bu_glw_trace_join(w[3], w[4]), payload(w[5], w[6]), w[2]);
+				return false;
+			case BU_GLW_TRACE_BUFFER_SUB_DATA:{
+				glBindBuffer(w[0], buffer(w[1]));
+				const void* data = payload(w[6], w[7]);
+				if(data != NULL)
+					glBufferSubData(w[0], (GLintptr)bu_glw_trace_join(w[2], w[3]), (GLsizeiptr)bu_glw_trace_join(w[4], w[5]), data);
+				return false;
+			}
+			case BU_GLW_TRACE_DELETE_BUFFER:
+				erase(m_buffers, w[0], deleteBuffer);
+				return false;
+
+			case BU_GLW_TRACE_CREATE_VERTEX_ARRAY:
+				createVertexArray(w[0]);
+				return false;
+			case BU_GLW_TRACE_BIND_VERTEX_ARRAY:
+				glBindVertexArray(vertexArray(w[0]));
+				return false;
+			case BU_GLW_TRACE_VERTEX_ATTRIB:
+				glVertexAttribPointer(w[0], (GLint)w[1], w[2], (GLboolean)w[3], (GLsizei)w[4], (void*)(uintptr_t)bu_glw_trace_join(w[5], w[6]));
+				glEnableVertexAttribArray(w[0]);
+				return false;
+			case BU_GLW_TRACE_DELETE_VERTEX_ARRAY:
+				erase(m_vertex_arrays, w[0], deleteVertexArray);
+				return false;
+
+			case BU_GLW_TRACE_SHADER_SOURCE:{
+				erase(m_shaders, w[0], deleteShader);
+				const GLchar* source = (const GLchar*)payload(w[2], w[3]);
+				GLuint shader = glCreateShader(w[1]);
+				if(source != NULL)
+					glShaderSource(shader, 1, &source, NULL);
+				glCompileShader(shader);
+				GLint success = 0;
+				glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+				if(!success){
+					char message[512] = {0};
+					glGetShaderInfoLog(shader, 512, NULL, message);
+					fprintf(stderr, "Shader %u does not compile here: %s\n", w[0], message);
+				}
+				m_shaders[w[0]] = shader;
+				return false;
+			}
+			case BU_GLW_TRACE_DELETE_SHADER:
+				erase(m_shaders, w[0], deleteShader);
+				return false;
+			case BU_GLW_TRACE_ATTACH_SHADER:{
+				std::unordered_map<uint32_t, GLuint>::const_iterator shader = m_shaders.find(w[1]);
+				if(shader != m_shaders.end())
+					glAttachShader(program(w[0]), shader->second);
+				return false;
+			}
+			case BU_GLW_TRACE_LINK_PROGRAM:{
+				GLuint linked = program(w[0]);
+				if(w[1] != 0)
+					glProgramParameteri(linked, GL_PROGRAM_SEPARABLE, GL_TRUE);
+				glLinkProgram(linked);
+				GLint success = 0;
+				glGetProgramiv(linked, GL_LINK_STATUS, &success);
+				if(!success){
+					char message[512] = {0};
+					glGetProgramInfoLog(linked, 512, NULL, message);
+					fprintf(stderr, "Program %u does not link here: %s\n", w[0], message);
+				}
+				return false;
+			}
+			case BU_GLW_TRACE_STAGE_PROGRAM:{
+				erase(m_programs, w[0], deleteProgram);
+				const GLchar* source = (const GLchar*)payload(w[2], w[3]);
+				if(source != NULL)
+					m_programs[w[0]] = glCreateShaderProgramv(w[1], 1, &source);
+				return false;
+			}
+			case BU_GLW_TRACE_USE_PROGRAM:
+				glUseProgram(program(w[0]));
+				return false;
+			case BU_GLW_TRACE_DELETE_PROGRAM:
+				erase(m_programs, w[0], deleteProgram);
+				return false;
+			case BU_GLW_TRACE_UNIFORM_LOCATION:{
+				const GLchar* name = (const GLchar*)payload(w[2], w[3]);
+				if(name != NULL)
+					m_locations[bu_glw_trace_join(w[1], w[0])] = glGetUniformLocation(program(w[0]), name);
+				return false;
+			}
+			case BU_GLW_TRACE_UNIFORM:
+				uniform(w);
+				return false;
+
+			case BU_GLW_TRACE_PIPELINE_STAGES:
+				glUseProgramStages(pipeline(w[0]), w[1], program(w[2]));
+				return false;
+			case BU_GLW_TRACE_BIND_PIPELINE:
+				glBindProgramPipeline(pipeline(w[0]));
+				return false;
+			case BU_GLW_TRACE_DELETE_PIPELINE:
+				erase(m_pipelines, w[0], deletePipeline);
+				return false;
+
+			case BU_GLW_TRACE_DRAW_ARRAYS:
+				glDrawArrays(w[0], (GLint)w[1], (GLsizei)w[2]);
+				return true;
+			case BU_GLW_TRACE_DRAW_ELEMENTS:
+				glDrawElements(w[0], (GLsizei)w[1], w[2], (void*)(uintptr_t)bu_glw_trace_join(w[3], w[4]));
+				return true;
+			case BU_GLW_TRACE_DISPATCH:
+				glUseProgram(program(w[0]));
+				glDispatchCompute(w[1], w[2], w[3]);
+				return true;
+			case BU_GLW_TRACE_DISPATCH_INDIRECT:
+				glUseProgram(program(w[0]));
+				glDispatchComputeIndirect((GLintptr)bu_glw_trace_join(w[1], w[2]));
+				return true;
+			case BU_GLW_TRACE_MEMORY_BARRIER:
+				glMemoryBarrier(w[0]);
+				return false;
+		}
+		return false;
+	}
+};
+
+static FrameStats replay_frame(Replayer& replayer, const std::vector<TraceRecord>& records, size_t begin, size_t end,
+                               CallStats* call_stats, bool print_calls){
+	FrameStats frame = FrameStats();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	for(size_t i = begin; i < end; ++i){
+		std::chrono::steady_clock::time_point call_start = std::chrono::steady_clock::now();
+		bool draw = replayer.execute(records[i]);
+		double ms = milliseconds(std::chrono::steady_clock::now() - call_start);
+
+		CallStats& stats = call_stats[records[i].opcode];
+		stats.count++;
+		stats.total_ms += ms;
+		if(ms > stats.max_ms)
+			stats.max_ms = ms;
+		frame.calls++;
+		frame.draws += draw ? 1 : 0;
+		if(print_calls)
+			printf("  %8zu %-20s %10.3f us\n", i, bu_glw_trace_opcode_name(records[i].opcode), ms * 1000.0);
+	}
+
+	frame.submit_ms = milliseconds(std::chrono::steady_clock::now() - start);
+	glFinish();
+	frame.total_ms = milliseconds(std::chrono::steady_clock::now() - start);
+	while(glGetError() != GL_NO_ERROR)
+		frame.errors++;
+	return frame;
+}
+
+static void print_call_stats(const CallStats* call_stats){
+	printf("%-20s %10s %12s %12s %12s\n", "call", "count", "total ms", "average us", "max us");
+	for(unsigned int op = 0; op < BU_GLW_TRACE_OPCODE_COUNT; ++op){
+		const CallStats& stats = call_stats[op];
+		if(stats.count == 0)
+			continue;
+		printf("%-20s %10llu %12.3f %12.3f %12.3f\n", bu_glw_trace_opcode_name(op), (unsigned long long)stats.count,
+			stats.total_ms, stats.total_ms * 1000.0 / stats.count, stats.max_ms * 1000.0);
+	}
+}
+
+static void print_frame(size_t index, const FrameStats& frame){
+	printf("%8zu %8zu %8zu %12.3f %12.3f", index, frame.calls, frame.draws, frame.submit_ms, frame.total_ms);
+	if(frame.errors != 0)
+		printf("   %u GL errors", frame.errors);
+	printf("\n");
+}
+
+int main(int argc, char** argv){
+	const char* path = NULL;
+	GLsizei width = 1280;
+	GLsizei height = 720;
+	long loop_frame = -1;
+	long loops = BU_GLW_REPLAY_DEFAULT_LOOPS;
+	bool print_calls = false;
+	bool bad_arguments = false;
+	for(int i = 1; i < argc; ++i){
+		if( strcmp(argv[i], "--size") == 0 && i + 1 < argc ){
+			if( sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0 )
+				bad_arguments = true;
+		}else if( strcmp(argv[i], "--loop") == 0 && i + 1 < argc ){
+			loop_frame = strtol(argv[++i], NULL, 10);
+		}else if( strcmp(argv[i], "--loops") == 0 && i + 1 < argc ){
+			loops = strtol(argv[++i], NULL, 10);
+		}else if( strcmp(argv[i], "--calls") == 0 ){
+			print_calls = true;
+		}else if(path == NULL){
+			path = argv[i];
+		}
+	}
+	if(path == NULL || loops < 1 || bad_arguments){
+		fprintf(stderr, "Usage: %s [--size WxH] [--loop FRAME] [--loops N] [--calls] trace.bugt\n", argv[0]);
+		return 1;
+	}
+
+	TraceContents trace;
+	try{
+		MappedFile file(path);
+		if( !bu_glw_trace_parse(file.data(), file.size(), trace) )
+			return 1;
+		const std::vector<TraceRecord>& records = trace.records;
+		const std::vector<size_t>& frame_ends = trace.frame_ends;
+		if(loop_frame >= (long)frame_ends.size()){
+			fprintf(stderr, "The trace has only %zu frames.\n", frame_ends.size());
+			return 1;
+		}
+		if( !bu_glw_headless_context() )
+			return 1;
+
+		printf("%s: %zu calls in %zu frames, %zu distinct payloads, replaying at %dx%d on %s\n", path, records.size(), frame_ends.size(),
+			trace.payloads.size(), width, height, (const char*)glGetString(GL_RENDERER));
+
+		RenderTarget color(RenderTargetDesc{width, height, GL_RGBA8, 0, false});
+		RenderTarget depth(RenderTargetDesc{width, height, GL_DEPTH24_STENCIL8, 0, false});
+		Framebuffer framebuffer;
+		framebuffer.attach(GL_COLOR_ATTACHMENT0, color);
+		framebuffer.attach(GL_DEPTH_STENCIL_ATTACHMENT, depth);
+		framebuffer.validate();
+		framebuffer.bind();
+		glViewport(0, 0, width, height);
+
+		Replayer replayer(trace.payloads);
+		CallStats call_stats[BU_GLW_TRACE_OPCODE_COUNT];
+		memset(call_stats, 0, sizeof(call_stats));
+
+		size_t last = loop_frame >= 0 ? (size_t)loop_frame : frame_ends.size() - 1;
+		bool report_frames = loop_frame < 0;
+		if(report_frames)
+			printf("%8s %8s %8s %12s %12s\n", "frame", "calls", "draws", "submit ms", "total ms");
+		for(size_t frame = 0; frame <= last && frame < frame_ends.size(); ++frame){
+			size_t begin = frame == 0 ? 0 : frame_ends[frame - 1];
+			FrameStats stats = replay_frame(replayer, records, begin, frame_ends[frame], call_stats, print_calls && report_frames);
+			if(report_frames)
+				print_frame(frame, stats);
+		}
+
+		if(loop_frame >= 0){
+			/* Only the looped runs are reported, the replay up to here only set the state up. */
+			memset(call_stats, 0, sizeof(call_stats));
+			size_t begin = loop_frame == 0 ? 0 : frame_ends[loop_frame - 1];
+			double total = 0, minimum = 0, maximum = 0, submit = 0;
+			printf("%8s %8s %8s %12s %12s\n", "run", "calls", "draws", "submit ms", "total ms");
+			for(long run = 0; run < loops; ++run){
+				FrameStats stats = replay_frame(replayer, records, begin, frame_ends[loop_frame], call_stats, print_calls && run == 0);
+				print_frame((size_t)run, stats);
+				total += stats.total_ms;
+				submit += stats.submit_ms;
+				if(run == 0 || stats.total_ms < minimum)
+					minimum = stats.total_ms;
+				if(stats.total_ms > maximum)
+					maximum = stats.total_ms;
+			}
+			printf("frame %ld, %ld runs: %.3f ms on average (%.3f submitting), %.3f min, %.3f max\n", loop_frame, loops,
+				total / loops, submit / loops, minimum, maximum);
+		}
+		print_call_stats(call_stats);
+	}catch(std::exception& e){
+		fprintf(stderr, "Replay failed: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}